@@ -5,8 +5,11 @@
 #include <string>
 #include <sstream>
 #include "COP97A.h"
+#include "CopResultCache.h"
 #include <algorithm>
 #include <iomanip>
+#include <climits>
+#include <cstring>
 
 /*
 MS bug and workaround: use std::vector  http://support.microsoft.com/kb/243444
@@ -21,84 +24,459 @@ namespace std {
 
 using namespace std;
 
+#if COP_PROFILING
+#define COP_PROFILED(statement) statement
+#define COP_COUNT_CALL(call) do { if (profileCalls != NULL) profileCalls[call]++; } while (0)
+#else
+#define COP_PROFILED(statement)
+#define COP_COUNT_CALL(call)
+#endif
+
 namespace COP97A{
 
-	void Cop97A::setOutput(bool option){
-		output = option;
+#if COP_PROFILING
+	// call counters of the worker on this thread, NULL outside a solve
+	static thread_local unsigned long long* profileCalls = NULL;
+#endif
+
+	CopWorkspace::CopWorkspace()
+		: stages(0), horizon(0), candidates(0), nPhases(0), workers(0), rolling(false), decisionBytes(sizeof(int)),
+		vOffset(0), qOffset(0), lOffset(0), sOffset(0), gOffset(0), seqOffset(0), fOffset(0)
+	{
+	}
+
+	bool CopWorkspace::reserve(unsigned int nStages, unsigned int nHorizon, unsigned int nCandidates, unsigned int phasesCount, unsigned int nWorkers,
+		bool nRolling, unsigned int nDecisionBytes)
+	{
+		if (nStages <= stages && nHorizon <= horizon && nCandidates <= candidates && phasesCount == nPhases
+			&& nWorkers <= workers && nRolling == rolling && nDecisionBytes == decisionBytes)
+			return false; // current layout fits, keep tables as they are
+
+		stages = max(stages, nStages);
+		horizon = max(horizon, nHorizon);
+		candidates = max(candidates, nCandidates);
+		nPhases = phasesCount;
+		workers = max(workers, nWorkers);
+		rolling = nRolling;
+		decisionBytes = nDecisionBytes;
+
+		// stage 0 keeps a row of its own, the others take turns in two
+		unsigned int rows = rolling ? 3 : stages;
+
+		vOffset = 0;
+		qOffset = vOffset + rows * horizon;
+		lOffset = qOffset + (horizon + 1) * nPhases * rows;
+		sOffset = lOffset + workers * candidates * nPhases;	// per-worker scratch
+		gOffset = sOffset + workers * candidates * nPhases;
+		seqOffset = gOffset + workers * candidates;
+		fOffset = seqOffset + stages;
+
+		buffer.assign(fOffset + stages * (nPhases + 1), 0);
+		decisions.assign(stages * horizon * decisionBytes, 0);
+		return true;
+	}
+
+	size_t CopWorkspace::bytes()
+	{
+		return buffer.size() * sizeof(int) + decisions.size();
+	}
+
+	bool CopWorkspace::isRolling()
+	{
+		return rolling;
+	}
+
+	std::vector<std::vector<int> > CopWorkspace::getValues(unsigned int nStages, unsigned int nHorizon)
+	{
+		// rolling tables only hold the rows of the last stages
+		if (rolling)
+			nStages = min(nStages, 3u);
+		std::vector<std::vector<int> > rows(nStages);
+		for (unsigned int i = 0; i < nStages; ++i)
+			rows[i].assign(&buffer[vOffset + i * horizon], &buffer[vOffset + i * horizon] + nHorizon);
+		return rows;
+	}
+
+	std::vector<std::vector<int> > CopWorkspace::getDecisions(unsigned int nStages, unsigned int nHorizon)
+	{
+		std::vector<std::vector<int> > rows(nStages);
+		for (unsigned int i = 0; i < nStages; ++i) {
+			rows[i].resize(nHorizon);
+			for (unsigned int s = 0; s < nHorizon; ++s)
+				rows[i][s] = decision(i, s);
+		}
+		return rows;
+	}
+
+	int CopLinearDischarge::getM(int /*phi*/, int xj, float satRate, float /*lostTime*/)
+	{
+		float m = 100000.0;	// use simplicity assumption if no sat-flow is set, arbitrily large value
+		if (satRate > 0)
+			m = satRate * xj; //TODO: Check startupLT
+		return (int)floor(m); // in vehicles
+	}
+
+	int CopLinearDischarge::getT(int d, int /*phi*/, float satRate, float lostTime)
+	{
+		float t = 0;
+		if (satRate > 0)
+			t = d / satRate;
+		return (int)ceil(t + lostTime); // in seconds
+	}
+
+	// one instance for every solver, so that shared caches see the same profile
+	static const std::shared_ptr<CopDischargeProfile>& defaultDischarge()
+	{
+		static const std::shared_ptr<CopDischargeProfile> linear = std::make_shared<CopLinearDischarge>();
+		return linear;
+	}
+
+	CopStartupDischarge::CopStartupDischarge(float utilization)
+		: laneUtilization(utilization)
+	{
+	}
+
+	int CopStartupDischarge::getM(int /*phi*/, int xj, float satRate, float lostTime)
+	{
+		if (satRate <= 0)
+			return 100000;
+		return (int)floor(satRate * laneUtilization * max(0.0f, xj - max(0.0f, lostTime)));
+	}
+
+	int CopStartupDischarge::getT(int d, int /*phi*/, float satRate, float lostTime)
+	{
+		float t = 0;
+		if (satRate > 0)
+			t = d / (satRate * laneUtilization);
+		return (int)ceil(max(0.0f, lostTime) + t);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setOutput(bool option){
+		trace = option ? &cout : NULL;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setTrace(ostream* sink){
+		trace = sink;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setThreads(int n){
+		threads = n < 1 ? 1 : n;
+		if (threads == 1)
+			pool.reset();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getThreads(){
+		return threads;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setWarmStart(bool option, float minReuse){
+		warmStart = option;
+		warmMinReuse = minReuse;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopWarmStats Cop<NPhases, Objective>::getWarmStartStats(){
+		return warmStats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopSolveStats Cop<NPhases, Objective>::getSolveStats(){
+		return result.stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopResult& Cop<NPhases, Objective>::getResult(){
+		return result;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopResult& Cop<NPhases, Objective>::getResult(CopObjective objective){
+		return objectiveResults[objective];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setVectorized(bool option){
+		kernel = option ? getCandidateKernel() : NULL;
+		multiKernel = option ? getMultiCandidateKernel() : NULL;
 	}
 
-	void Cop97A::setInitialPhase(int ph){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setPruning(bool option){
+		pruning = option;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setLongHorizon(bool option){
+		longHorizon = option;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setLazy(bool option){
+		lazy = option;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	size_t Cop<NPhases, Objective>::getWorkspaceBytes(){
+		return ws.bytes();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setResultCache(size_t maxBytes){
+		if (maxBytes == 0)
+			cache.reset();
+		else if (cache)
+			cache->setMaxBytes(maxBytes);
+		else
+			cache = std::make_shared<CopResultCache>(maxBytes);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setResultCache(std::shared_ptr<CopResultCache> shared){
+		cache = shared;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	std::shared_ptr<CopResultCache> Cop<NPhases, Objective>::getResultCache(){
+		return cache;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setStateBand(const std::vector<int>& low, const std::vector<int>& high){
+		bandLow = low;
+		bandHigh = high;
+		bandHigh.resize(bandLow.size(), T);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopProfile& Cop<NPhases, Objective>::getProfile(){
+		return profile;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setInitialPhase(int ph){
 		idxCurrentPh = initialPhase = ph;
 	}
 	
-	void  Cop97A::setSaturationFlow(int phi, float satFlow) {
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setSaturationFlow(int phi, float satFlow) {
 		satFlows[phi] = satFlow;
+		dischargeStale = true;
 	}
 
-	void  Cop97A::setLanePhases(int phi, int lanes) {
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setLanePhases(int phi, int lanes) {
 		lanePhases[phi] = lanes;
+		dischargeStale = true;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile) {
+		dischargeProfile = profile ? profile : defaultDischarge();
+		dischargeStale = true;
+		firstChange = 0;	// no warm start across profiles
 	}
 	
-	void Cop97A::setStartupLostTime(float time){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setStartupLostTime(float time){
 		startupLostTime = time;
+		dischargeStale = true;
 	}
 		
-	void Cop97A::setMinGreenTime(int mgreen){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setMinGreenTime(int mgreen){
 		mingreen = mgreen;
 	}
 	
-	void Cop97A::setMaxGreenTime(int mxgreen){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setMaxGreenTime(int mxgreen){
 		maxgreen = mxgreen;
 	}
 
-	void Cop97A::setRedTime(int rd){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setRedTime(int rd){
 		red= rd;
 	}
 
-	void Cop97A::setHorizon(int h){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setHorizon(int h){
 		T= h;
 		resizeArrivals();
 	}
 	
-	void Cop97A::setMaxPhCompute(int mp){
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setMaxPhCompute(int mp){
 		M= mp;
 	}
 
-	void Cop97A::setArrivals(std::vector<std::vector<int> > arrivals){
-		arrivalData = arrivals;
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::configure(const CopJunction& junction){
+		setInitialPhase(junction.initialPhase);
+		red = junction.red;
+		mingreen = junction.mingreen;
+		maxgreen = junction.maxgreen;
+		M = junction.maxPhases;
+		if (startupLostTime != junction.lostTime)
+			setStartupLostTime(junction.lostTime);
+		for (unsigned int p = 0; p < NPhases; p++) {
+			if (satFlows[p] != junction.satFlows[p])
+				setSaturationFlow(p, junction.satFlows[p]);
+			if (lanePhases[p] != junction.lanes[p])
+				setLanePhases(p, junction.lanes[p]);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setArrivals(const std::vector<std::vector<int> >& arrivals){
+		arrivalStore.resize(arrivals.size() * NPhases);	// keeps its capacity between horizons
+		for (unsigned int k = 0; k < arrivals.size(); ++k)
+			for (unsigned int p = 0; p < NPhases; ++p)
+				arrivalStore[k * NPhases + p] = arrivals[k][p];
+
+		unsigned int from = firstChangedSlot(arrivalStore.data(), arrivals.size(), NPhases, 1);
+		arrivalView = NULL;
+		arrivalSlots = arrivals.size();
+		slotStride = NPhases;
+		phaseStride = 1;
+		buildArrivalIndex(from);
 	};
 
-	void Cop97A::initParameters(){
-		PI = DELAY;
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::setArrivals(const int* data, unsigned int slots, unsigned int dataSlotStride, unsigned int dataPhaseStride){
+		/*
+		* arrivals of slot k and phase p at data[k * dataSlotStride + p * dataPhaseStride],
+		* read in place by every solve until the next setArrivals, setHorizon or load,
+		* which drop it unread
+		*/
+		unsigned int from = firstChangedSlot(data, slots, dataSlotStride, dataPhaseStride);
+		arrivalView = data;
+		arrivalSlots = slots;
+		slotStride = dataSlotStride;
+		phaseStride = dataPhaseStride;
+		buildArrivalIndex(from);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int Cop<NPhases, Objective>::firstChangedSlot(const int* data, unsigned int slots, unsigned int dataSlotStride, unsigned int dataPhaseStride){
+		// the current horizon is read back from its prefix sums, the caller may have overwritten it in place
+		if (slots != arrivalSlots || cumArrivals.size() != NPhases || cumArrivals[0].size() != slots + 1)
+			return 0;
+
+		for (unsigned int k = 0; k < slots; ++k)
+			for (unsigned int p = 0; p < NPhases; ++p)
+				if (data[k * dataSlotStride + p * dataPhaseStride] != cumArrivals[p][k + 1] - cumArrivals[p][k])
+					return k;
+		return slots;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::ownArrivals(unsigned int slots){
+		// a view is dropped, not read: its caller may have released it since
+		if (arrivalView != NULL) {
+			arrivalStore.clear();
+			arrivalView = NULL;
+			slotStride = NPhases;
+			phaseStride = 1;
+		}
+		arrivalStore.resize(slots * NPhases, 0);	// slots past the old horizon start empty
+		arrivalSlots = slots;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::initParameters(){
 		red = 1; //1
 		mingreen = 2; //2
 		maxgreen = 50;
 		startupLostTime = 0;
+		setDischargeProfile(NULL);
 		T = 10; //planning horizon
 		M = 9; //maximum number of phases to compute (1 to M-1)
-		phaseSeq[0]= 'A';phaseSeq[1]= 'B';phaseSeq[2]= 'C';
-		setSaturationFlow(0, -1.0); setSaturationFlow(1, -1.0); setSaturationFlow(2, -1.0);
-		phases = std::vector<int>(phaseSeq, phaseSeq + sizeof (phaseSeq) /sizeof (phaseSeq[0]));
-		output = false;
+		for (unsigned int p = 0; p < NPhases; p++) {
+			phaseSeq[p] = 'A' + p;		// A, B, C, ...
+			setSaturationFlow(p, -1.0);
+			setLanePhases(p, 1);
+		}
+		trace = NULL;
+		threads = 1;
+		kernel = getCandidateKernel();
+		multiKernel = getMultiCandidateKernel();
+		pruning = false;
+		longHorizon = false;
+		lazy = false;
+		minLevels = 0;
+		warmStart = false;
+		warmMinReuse = 0.25f;
+		warmStages = 0;
+		firstChange = 0;
+		result.value = 0;
+		result.stats.stages = 0;
+		result.stats.converged = result.stats.deadlineHit = false;
+		result.stats.seconds = 0;
+		result.stats.candidates = result.stats.pruned = 0;
+		result.stats.cached = false;
+		result.stats.states = 0;
+		result.stats.skipped = 0;
+		profileOuter = NULL;
+		arrivalView = NULL;
+		arrivalSlots = 0;
+		slotStride = NPhases;
+		phaseStride = 1;
 		resizeArrivals();
 	}
 
-	void Cop97A::resizeArrivals()
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::resizeArrivals()
 	{
-		arrivalData.resize(T);
-		for (unsigned int i = 0; i < T; ++i) {
-			arrivalData[i].resize(phases.size());
+		ownArrivals(T);
+		buildArrivalIndex();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::buildArrivalIndex(unsigned int from)
+	{
+		/*
+		* cumulative counts per phase over [0,k), so that getArrivals and getB
+		* are answered by differences instead of walking the arrivals each call.
+		* Slots before from are unchanged and keep their sums.
+		*/
+		unsigned int nSteps = arrivalSlots;
+		if (cumArrivals.size() != NPhases || cumArrivals[0].size() != nSteps + 1)
+			from = 0;
+
+		firstChange = min(firstChange, from);
+		cumArrivals.resize(NPhases);
+		cumRequests.resize(NPhases);
+		cumRequestTimes.resize(NPhases);
+
+		for (unsigned int p = 0; p < NPhases; ++p) {
+			cumArrivals[p].resize(nSteps + 1);
+			cumRequests[p].resize(nSteps + 1);
+			cumRequestTimes[p].resize(nSteps + 1);
+			cumArrivals[p][0] = cumRequests[p][0] = cumRequestTimes[p][0] = 0;
+
+			for (unsigned int k = from; k < nSteps; ++k) {
+				int arrivals = arrival(k, p);
+				cumArrivals[p][k + 1] = cumArrivals[p][k] + arrivals;
+				cumRequests[p][k + 1] = cumRequests[p][k] + (arrivals != 0 ? 1 : 0);
+				cumRequestTimes[p][k + 1] = cumRequestTimes[p][k] + (arrivals != 0 ? k : 0);
+			}
 		}
 	}
 
-	Cop97A::Cop97A(char* file, int iphase){
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(char* file, int iphase){
 		initParameters();
 		if(!loadFromFile(file))
 			exit(0);
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	Cop97A::Cop97A(char* file, int iphase, int horizon){
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(char* file, int iphase, int horizon){
 		initParameters();
 		setHorizon(horizon);
 		if(!loadFromFile(file))
@@ -106,28 +484,40 @@ namespace COP97A{
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	Cop97A::Cop97A(char* data, int size, int nphases, int iphase){
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(char* data, int size, int nphases, int iphase){
 		initParameters();
 		if(!loadFromSeq(data, size, nphases))
 			exit(0);
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	Cop97A::Cop97A(std::vector<int> data, int nphases, int iphase){
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(const std::vector<int>& data, int nphases, int iphase){
 		initParameters();
 		if(!loadFromVector(data, nphases))
 			exit(0);
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	Cop97A::Cop97A(std::vector<std::vector<int> > data, int iphase, int horizon){
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(const std::vector<std::vector<int> >& data, int iphase, int horizon){
 		initParameters();
 		setHorizon(horizon);
-		arrivalData = data;
+		setArrivals(data);
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	Cop97A::Cop97A(int iphase, int horizon){
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(const int* data, unsigned int slots, int iphase, int horizon){
+		initParameters();
+		setHorizon(horizon);
+		setArrivals(data, slots);
+		idxCurrentPh = initialPhase = iphase;
+	};
+
+	template<unsigned int NPhases, CopObjective Objective>
+	Cop<NPhases, Objective>::Cop(int iphase, int horizon){
 		initParameters();
 		setInitialPhase(iphase);
 		setHorizon(horizon);
@@ -135,9 +525,19 @@ namespace COP97A{
 	
 	};
 
-	std::vector<int>  Cop97A::getFeasibleGreens(int sj, int j) {
+	template<unsigned int NPhases, CopObjective Objective>
+	std::vector<int> Cop<NPhases, Objective>::getFeasibleGreens(int sj, int j) {
 
-		std::vector< int > set;
+		std::vector< int > set(2 + max(0, maxgreen - mingreen)); // any sj
+		set.resize(getFeasibleGreens(sj, j, &set[0]));
+
+		return set;
+	};
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getFeasibleGreens(int sj, int j, int set[]) {
+
+		int size = 0;
 
 		//if (j == 1) //simplification removes the min green restriction for stage 1
 		//{
@@ -152,23 +552,23 @@ namespace COP97A{
 			//set.push_back(0);
 			int gg = sj - red;
 			if (gg < mingreen)
-				set.push_back(mingreen);
+				set[size++] = mingreen;
 			else
 			{
 				if (gg <= maxgreen)	// NEW
-					set.push_back(gg);
+					set[size++] = gg;
 				else
-					set.push_back(maxgreen);	//NEW
+					set[size++] = maxgreen;	//NEW
 			}
 		}
 		
 		else {
-			set.push_back(0);		// allow phase skipping
+			set[size++] = 0;		// allow phase skipping
 			int c = mingreen;
 
 			if (!(sj - red < mingreen)) {
 				do {
-					set.push_back(c);
+					set[size++] = c;
 					c++;
 					if (c > maxgreen) //NEW
 					{
@@ -178,49 +578,61 @@ namespace COP97A{
 			}
 		}
 
-		return set;
+		return size;
 	};
 
-	int Cop97A::getArrivals(int a, int b, int phi) {
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getMaxCandidates() {
+		// zero, mingreen, then every green up to min(maxgreen, T)
+		int greens = min(maxgreen, (int)T) - mingreen;
+		return 2 + max(0, greens);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getArrivals(int a, int b, int phi) {
+		COP_COUNT_CALL(COP_CALL_ARRIVALS);
 
 		if (a == b)
 			return 0;
 
-		int vehicles = 0;
-		int cc = a;
+		if (a > b) // walking [a,b) visited step a once before the bound check
+			return arrival(a, phi);
 
-		do {
-			vehicles += arrivalData[cc][phi];
-			cc++;
-		} while (cc < b); // for [a,b), with a!=b
+		return cumArrivals[phi][b] - cumArrivals[phi][a]; // for [a,b), with a!=b
+	}
 
-		return vehicles;
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getQ(int sj, int ph, int j) {
+		return getQ(ws, sj, ph, j);
 	}
 
-	int  Cop97A::getQ(int sj, int ph, int j) {
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getQ(CopWorkspace& tables, int sj, int ph, int j) {
+		COP_COUNT_CALL(COP_CALL_Q);
 
 		if (sj == 0)
 			return 0; //assuming initial queues are zero
 		//index fix
-		return Q[sj - 1][ph][j - 1]; //NEW: sj, starts at red, but this is a vector index fix
+		return tables.queue(sj - 1, ph, j - 1); //NEW: sj, starts at red, but this is a vector index fix
 		//return Q[sj - red][ph][j - 1]; //was: this might be sj-1 instead
 	}
 
-	int  Cop97A::getB(int a, int b, int phi) {
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getB(int a, int b, int phi) {
+		COP_COUNT_CALL(COP_CALL_B);
 
-		int dB = 0;
-		int k = a; 
-		int bb = b;
+		if (a >= b)
+			return 0;
 
-		while (k < b) { //a <= ak < b
-			if (arrivalData[k][phi] != 0) //if vehicle k requests phase phi
-				dB += b - k;
-			k++;
-		}
-		return dB;
+		// sum of (b - k) over a <= k < b where vehicle k requests phase phi
+		int requests = cumRequests[phi][b] - cumRequests[phi][a];
+		int requestTimes = cumRequestTimes[phi][b] - cumRequestTimes[phi][a];
+
+		return requests * b - requestTimes;
 	}
 
-	int  Cop97A::getArrivalEarliest(int si, int sj, int xj, int phi)
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getArrivalEarliest(int si, int sj, int xj, int phi)
 	{
 
 		//arrival time of the earliest vehicle required to stop when phi(j);
@@ -230,7 +642,7 @@ namespace COP97A{
 		//NEW TODO: Work on improvements?
 		//if(si > xj)
 		//{
-		//	for (int oph = 0; oph < phases.size(); oph++)
+		//	for (int oph = 0; oph < NPhases; oph++)
 		//	{
 		//		if (oph!=phi)	// check  other phases
 		//		{
@@ -252,62 +664,93 @@ namespace COP97A{
 		return timeArrival;
 	}
 	
-	int  Cop97A::getM(int phi, int xj) { 
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getM(int phi, int xj) { 
+		COP_COUNT_CALL(COP_CALL_M);
 		// Maximum no. of vehicles that can be discharged in xj seconds for phase phi
-
-		/*  TODO: simplicity assumption: M_phi(x) = INF for all x > 0;
-		*   i.e. instantaneous queue clearance
-		*
-		*  M_phi (x) = saturation_flow_rate_(phi) * x
-		* saturation_flow_rate_ in vphpl vehicles per hour per lane for phase phi
-		*/
-
-		/*
-		if (xj == 0)
-			return 0;
-
-		return 100000;
-		*/
+		if (!dischargeStale && (unsigned int)xj < dischargeVehicles[phi].size())
+			return dischargeVehicles[phi][xj];
 
 		if (xj == 0)
 			return 0;
-
-		float satRate = getSaturationFlow(phi);
-		float m = 100000.0;
-
-		//return 100000;		// use simplicity assumption if no sat-flow is set, arbitrily large value
-		if (satRate > 0)
-			m = satRate * xj; //TODO: Check startupLT
-		//float m = satRate * (xj - startupLostTime); //TODO: Check startupLT
-		return (int)floor(m); // in vehicles
-	
+		return max(0, dischargeProfile->getM(phi, xj, getSaturationFlow(phi), startupLostTime));
 	}
 
-	int  Cop97A::getT(int d, int phi) {	
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getT(int d, int phi) {	
+		COP_COUNT_CALL(COP_CALL_T);
 		//function of no of vehicles discharged, total delay in discharging d vehicles
+		if (!dischargeStale && (unsigned int)d < dischargeTimes[phi].size())
+			return dischargeTimes[phi][d];
 
-		// example assumption, instantaneous queue clearance = 0, for all d
-		/*
-		* T_phi (d) = d / saturation_flow_rate_(phi)
-		* d is the number of vehicles to discharge
-		*
-		*/
+		if (d == 0)
+			return 0;
+		return dischargeProfile->getT(d, phi, getSaturationFlow(phi), startupLostTime);
+	}
 
-		//return 0;
+	/*
+	* getT is only asked for d = min(Q, M), so the times cover every d a green
+	* clears. If that is unbounded, as with no saturation flow set, they cover
+	* at least what can queue instead: each arrival once, but stage 1 may count
+	* one slot twice (see getArrivals).
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int Cop<NPhases, Objective>::getDischargeTimesSize(unsigned int phi, unsigned int greens) {
+		unsigned int most = (unsigned int)dischargeMost[phi] + 1;
+		if (most <= 8 * greens)
+			return most;
+
+		int total = cumArrivals.size() == NPhases ? cumArrivals[phi].back() : 0;
+		return min(most, max(8 * greens, 2 * (unsigned int)max(0, total) + 1));
+	}
 
+	/*
+	* Samples the discharge profile of every phase over the greens of the
+	* solve and the vehicles that can queue, so that getM and getT are loads.
+	* Tables are rebuilt when the parameters change, and grow when T, the
+	* greens or the arrivals outgrow them.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::buildDischargeTables() {
+		// greens are at most min(maxgreen, T), or mingreen at stage 1
+		unsigned int greens = max(mingreen, min(maxgreen, (int)T)) + 1;
+		if (dischargeVehicles.size() != NPhases) {
+			dischargeVehicles.resize(NPhases);
+			dischargeTimes.resize(NPhases);
+			dischargeStale = true;
+		}
 
-		if (d==0)
-			return 0;
+		for (unsigned int p = 0; p < NPhases; p++) {
+			vector<int>& vehicles = dischargeVehicles[p];
+			vector<int>& times = dischargeTimes[p];
+			if (!dischargeStale && vehicles.size() >= greens && times.size() >= getDischargeTimesSize(p, greens))
+				continue;
+
+			float satRate = getSaturationFlow(p);
+			vehicles.resize(max(greens, dischargeStale ? 0 : (unsigned int)vehicles.size()));
+			vehicles[0] = 0;
+			dischargeMost[p] = 0;
+			for (unsigned int x = 1; x < vehicles.size(); x++) {
+				vehicles[x] = max(0, dischargeProfile->getM(p, x, satRate, startupLostTime));	// also indexes times
+				dischargeMost[p] = max(dischargeMost[p], vehicles[x]);
+			}
 
-		float satRate = getSaturationFlow(phi);
-		float t = 0;
-	    if(satRate > 0)
-			t  = d / satRate;	
-		
-		return (int)ceil(t + startupLostTime); // in seconds //TODO: Check startupLT ..  + startupLostTime
+			unsigned int size = getDischargeTimesSize(p, greens);
+			if (!dischargeStale && size > times.size())	// by doubling, arrivals change every solve
+				size = max(size, min(2 * (unsigned int)times.size(), (unsigned int)dischargeMost[p] + 1));
+			times.resize(max(size, dischargeStale ? 1u : (unsigned int)times.size()));
+			times[0] = 0;
+			dischargeTimeMin[p] = 0;
+			for (unsigned int d = 1; d < times.size(); d++) {
+				times[d] = dischargeProfile->getT(d, p, satRate, startupLostTime);
+				dischargeTimeMin[p] = min(dischargeTimeMin[p], times[d]);
+			}
+		}
+		dischargeStale = false;
 	}
 
-	float  Cop97A::getSaturationFlow(int phi) { // sat-flow rate per phase, not per lane. in vehicles per sec
+	template<unsigned int NPhases, CopObjective Objective>
+	float Cop<NPhases, Objective>::getSaturationFlow(int phi) { // sat-flow rate per phase, not per lane. in vehicles per sec
 		// NOTE: Simplicity assumption return 0;
 		float sf = satFlows[phi];
 		if (sf <0) return 0;
@@ -315,36 +758,49 @@ namespace COP97A{
 		return (satFlows[phi]/3600)*lanePhases[phi]; // in vphpl, to vpspl
 	}
 
-	std::vector<int> Cop97A::getOptimalControl(){
-		return optControlSequence;
+	template<unsigned int NPhases, CopObjective Objective>
+	std::vector<int> Cop<NPhases, Objective>::getOptimalControl(){
+		return result.sequence;
 	}; 
 
-	int Cop97A::getInitialPhase(){
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getOptimalControl(int out[], int capacity){
+		int size = (int)result.sequence.size();
+		copy(result.sequence.begin(), result.sequence.begin() + min(size, max(0, capacity)), out);
+		return size;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getInitialPhase(){
 		return initialPhase;
 	}
 
-	int Cop97A::getRed(){
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getRed(){
 		return red;
 	}
 
-	void  Cop97A::printArrivals() {
-		cout << "\n\n"; 
-		for (unsigned int p=0; p < phases.size(); ++p)
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::printArrivals() {
+		ostream& out = trace ? *trace : cout;
+		out << "\n\n"; 
+		for (unsigned int p=0; p < NPhases; ++p)
 		{
-			cout << "\t" << phaseSeq[p];
+			out << "\t" << phaseSeq[p];
 		}
-		cout << "\n\n";
+		out << "\n\n";
 		for (unsigned int i = 0; i < T; ++i) {
-			cout << i+1 << "\t";
-			for (unsigned int j = 0; j < phases.size(); ++j) {
-				cout << arrivalData[i][j] << "\t";
+			out << i+1 << "\t";
+			for (unsigned int j = 0; j < NPhases; ++j) {
+				out << arrival(i, j) << "\t";
 			}
-			cout << endl;
+			out << endl;
 		}
-		cout << endl;
+		out << endl;
 	}
 
-	bool  Cop97A::loadFromFile(char* filename) {
+	template<unsigned int NPhases, CopObjective Objective>
+	bool Cop<NPhases, Objective>::loadFromFile(char* filename) {
 		unsigned int x, y;
 		ifstream in(filename);
 
@@ -353,22 +809,26 @@ namespace COP97A{
 			return false;
 		}
 
+		ownArrivals(arrivalSlots);
 		for (y = 0; y < T; y++) {
-			for (x = 0; x < phases.size(); x++) {
+			for (x = 0; x < NPhases; x++) {
 
-				in >> arrivalData[y][x];
+				in >> arrivalStore[y * NPhases + x];
 			}
 		}
 		in.close();
+		buildArrivalIndex();
 
 		return true;
 	};
 
-	bool Cop97A::loadFromSeq(char* data, unsigned int size, int nPhases) {
+	template<unsigned int NPhases, CopObjective Objective>
+	bool Cop<NPhases, Objective>::loadFromSeq(char* data, unsigned int size, int nPhases) {
 		
 		//ifstream in(filename);
 		int ic = 0;
 		int dataI;
+		ownArrivals(arrivalSlots);
 		for (unsigned int ix = 0; ix < size; ++ix)
 		{
 			dataI = data[ix];
@@ -377,305 +837,907 @@ namespace COP97A{
 			// TODO: works only for 1 digit data
 			if(dataI >= 0) // skip spaces 
 			{
-				arrivalData[ic/nPhases][ic%nPhases] = dataI; 
+				arrivalStore[ic/nPhases * NPhases + ic%nPhases] = dataI; 
 				ic++;
 			}
 		}
+		buildArrivalIndex();
 
 		return true;
 	}
 
-	bool Cop97A::loadFromVector(std::vector<int> data, int nPhases) {
+	template<unsigned int NPhases, CopObjective Objective>
+	bool Cop<NPhases, Objective>::loadFromVector(const std::vector<int>& data, int nPhases) {
 		
+		ownArrivals(arrivalSlots);
 		for (unsigned int ix = 0; ix < data.size(); ++ix)
 		{
-			arrivalData[ix/nPhases][ix%nPhases] = data[ix];
+			arrivalStore[ix/nPhases * NPhases + ix%nPhases] = data[ix];
 		}
+		buildArrivalIndex();
 		return true;
 	}
 
-	void  Cop97A::initMatrices(int init) {
-		for (unsigned int i = 0; i < v.size(); ++i) {
-			for (unsigned int j = 0; j < v[i].size(); ++j) {
-				if (i == 0) {
-					x_star[i][j] = v[i][j] = 0;
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::initMatrices(int init) {
+		initTables(ws, init);
+	}
 
-				} else {
-					x_star[i][j] = v[i][j] = init;
-				}
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::initTables(CopWorkspace& tables, int init) {
+		// rolling tables hold the value and queue rows of stages 0, 1 and 2 only
+		unsigned int rows = tables.isRolling() ? min(M, 3u) : M;
+		for (unsigned int i = 0; i < M; ++i)
+			for (unsigned int j = 0; j < T; ++j)
+				tables.setDecision(i, j, i == 0 ? 0 : init);
+
+		for (unsigned int i = 0; i < rows; ++i) {
+			for (unsigned int j = 0; j < T; ++j) {
+				tables.value(i, j) = i == 0 ? 0 : init;
+
+				// getQ reads up to s = T - 1 but states only write up to T - red,
+				// clear the rest so that a reused workspace solves like a new one
+				for (unsigned int pp = 0; pp < NPhases; ++pp)
+					tables.queue(j, pp, i) = 0;
 			}
 		}
 	}
 
-	vector<int>  Cop97A::printSequence(int arry[], int sz) {
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::buildCacheKey() {
+		// everything solve reads, floats by their bits
+		int bits;
+		cacheKey.clear();
+		cacheKey.push_back(NPhases);
+		cacheKey.push_back(Objective);
+		cacheKey.push_back(idxCurrentPh);
+		cacheKey.push_back(red);
+		cacheKey.push_back(mingreen);
+		cacheKey.push_back(maxgreen);
+		cacheKey.push_back(T);
+		cacheKey.push_back(M);
+		memcpy(&bits, &startupLostTime, sizeof(bits));
+		cacheKey.push_back(bits);
+		for (unsigned int p = 0; p < NPhases; p++) {
+			memcpy(&bits, &satFlows[p], sizeof(bits));
+			cacheKey.push_back(bits);
+			cacheKey.push_back(lanePhases[p]);
+		}
+		// a profile of the caller by what it gives, the tables
+		bool linear = dischargeProfile == defaultDischarge();
+		cacheKey.push_back(linear ? 0 : 1);
+		for (unsigned int p = 0; p < NPhases && !linear; p++) {
+			cacheKey.push_back((int)dischargeVehicles[p].size());
+			cacheKey.insert(cacheKey.end(), dischargeVehicles[p].begin(), dischargeVehicles[p].end());
+			cacheKey.push_back((int)dischargeTimes[p].size());
+			cacheKey.insert(cacheKey.end(), dischargeTimes[p].begin(), dischargeTimes[p].end());
+		}
+		cacheKey.push_back(arrivalSlots);
+		for (unsigned int k = 0; k < arrivalSlots; k++)
+			for (unsigned int p = 0; p < NPhases; p++)
+				cacheKey.push_back(arrival(k, p));
+	}
 
-		vector<int> seq;
-		cout << "[ ";
-		for (int i = 0; i < sz; i++) {
-			seq.push_back(arry[i]);
-			cout << phaseSeq[(i+initialPhase)%phases.size()]<<":"<< arry[i] << " ";
+	template<unsigned int NPhases, CopObjective Objective>
+	bool Cop<NPhases, Objective>::reserveWorkspace() {
+		result.sequence.reserve(M);
+		result.queues.reserve(NPhases);
+		if (pruning) {
+			minTables.reserve((NPhases + 1) * (T + 1) * 12);	// levels for T up to 4095
+			pruneCounts.reserve(threads);
 		}
-		cout << "]";
+		if (!longHorizon)
+			return ws.reserve(M, T, getMaxCandidates(), NPhases, threads);
+
+		// decisions are greens, at most min(maxgreen, T)
+		unsigned int greenMax = (unsigned int)max(0, min(maxgreen, (int)T));
+		unsigned int decisionBytes = greenMax <= UCHAR_MAX ? 1 : greenMax <= USHRT_MAX ? 2 : sizeof(int);
+		return ws.reserve(M, T, getMaxCandidates(), NPhases, threads, true, decisionBytes);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	typename Cop<NPhases, Objective>::WarmKey Cop<NPhases, Objective>::getWarmKey() {
+		WarmKey key;
+		key.phase = idxCurrentPh;
+		key.red = red;
+		key.mingreen = mingreen;
+		key.maxgreen = maxgreen;
+		key.T = T;
+		key.M = M;
+		key.lostTime = startupLostTime;
+		for (unsigned int p = 0; p < NPhases; p++)
+			key.satRates[p] = getSaturationFlow(p);
+		return key;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	bool Cop<NPhases, Objective>::sameWarmKey(const WarmKey& a, const WarmKey& b) {
+		if (a.phase != b.phase || a.red != b.red || a.mingreen != b.mingreen || a.maxgreen != b.maxgreen
+			|| a.T != b.T || a.M != b.M || a.lostTime != b.lostTime)
+			return false;
+
+		for (unsigned int p = 0; p < NPhases; p++)
+			if (a.satRates[p] != b.satRates[p])
+				return false;
+		return true;
+	}
+
+	/*
+	* Last state sj of stage j whose tables from the previous solve still hold.
+	* Stage 1 reads arrivals before max(sj, mingreen + 1); stage j also reads
+	* Q_{j-1} up to state sj + red - 1 (skipped phase), so the bound shrinks.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::getWarmBound(unsigned int j) {
+		int d = min(firstChange, T);
+		if (!warmStats.warm || j > warmStages || mingreen + 1 > d)
+			return red - 1;	// nothing reusable
+
+		return d - (int)(j - 1) * max(0, red - 1);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> Cop<NPhases, Objective>::printSequence(int arry[], int sz) {
+
+		printControl(arry, sz);
+		return vector<int>(arry, arry + sz);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::printControl(int arry[], int sz) {
+		ostream& out = trace ? *trace : cout;
 
-		return seq;
+		out << "[ ";
+		for (int i = 0; i < sz; i++) {
+			out << phaseSeq[(i+initialPhase)%NPhases]<<":"<< arry[i] << " ";
+		}
+		out << "]";
 	}
 
-	void  Cop97A::printVector(vector<int> values) {
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::printVector(vector<int> values) {
+		ostream& out = trace ? *trace : cout;
 
-		cout << flush << "[  ";
+		out << flush << "[  ";
 		for (vector<int>::iterator i = values.begin(); i != values.end(); ++i) {
 			if (i!= values.begin())
-				cout << setfill (' ' ) << setw (3);
+				out << setfill (' ' ) << setw (3);
 
 			int ix = *i;
 			if (ix < 0)
-				cout << "-";
+				out << "-";
 			else
-				cout <<ix;
+				out <<ix;
 		}
-		cout << "  ]";
+		out << "  ]";
 	}
 
-	void  Cop97A::printMatrix(vector<vector<int> > values) {
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::printMatrix(vector<vector<int> > values) {
+		ostream& out = trace ? *trace : cout;
 
 		for (unsigned int i = 0; i < values.size(); ++i) {
 			printVector(values[i]);
-			cout << endl;
+			out << endl;
 		}
 	}
 
-	vector<int> Cop97A::RunCOP() {
-		cout << "COP started...\n";
+	/*
+	* Temporary queues and stops of green xj for state sj at stage j, stored
+	* at index_xj in the worker scratch; returns the value function candidate.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	template<CopObjective O>
+	int Cop<NPhases, Objective>::evaluateGreen(CopWorkspace& tables, unsigned int j, unsigned int sj, int xj, int index_xj, unsigned int worker) {
 
-		cout << "\n\nInput Arrival Data: ";
-		//printArrivals();
+		int hj = (xj!=0) ? (xj+red) : 0; //transition value
 
-		std::vector< std::vector<int> > X;
-		X.resize(T);
+		// at stage 0, no steps allocated
+		int si = (j!=1) ? (sj-hj) : 0; // si equals s_{j-1}
+		//  cout << "\n hj, si: " <<hj << ", " << si<< "\n";
 
-		v.resize(M);
-		x_star.resize(M);
+		int currentValueFn = -1;
+		int tQueue = 0;
+		int tStops = 0;
+		int tDelay = 0;
 
-		for (unsigned int i = 0; i < M; ++i) {
-			v[i].resize(T);
-			x_star[i].resize(T);
-		}
+		int index_maxPh = -1;
 
-		initMatrices(-1);
-		unsigned int j = 1;
-		bool criterion_flag = 1;
+		//performance index calculation Max Q Length
+		// which phase has the longest temp queue?
+		int pi_MaxQ = -1;
+		int pi_NumStops = 0;
+		int pi_Delay = 0;
 
-		do {
-			if(output){
-				// <editor-fold defaultstate="collapsed" desc="header stage">
-				cout << endl << "\n\t\t\tStage " << j << " Calculations [" << phaseSeq[idxCurrentPh] << "]" << endl;
-				cout << "--------------------------------------------------------------------" << endl;
-				cout << "s" << j << "\tx*(s" << j << ")\tv(s" << j << ")\tQA\tQB\tQC\tXj(s" << j << ")\n";
-				cout << "--------------------------------------------------------------------"<< endl;
-				// </editor-fold>
+		for (unsigned int index_p = 0; index_p < NPhases; index_p++) {
+
+			if (index_p != idxCurrentPh) // phase w/o right-of-way
+			{
+
+				// temporary queues
+				tQueue = getQ(tables, si, index_p, j - 1)
+					+ getArrivals(si, sj, index_p);
+
+				// temporary stops
+				tStops = getArrivals(si, sj, index_p);
+
+				//delay
+				tDelay = getQ(tables, si, index_p, j - 1)*(sj - si)
+					+ getB(si, sj, index_p);
+
+			} else { //phase with right-of-way
+
+				// temporary queues
+				int queueTerm = getQ(tables, si, idxCurrentPh, j - 1)
+					+ getArrivals(si, si + xj, idxCurrentPh)
+					- getM(idxCurrentPh, xj);
+
+				tQueue = max(0, queueTerm) 
+					+ getArrivals(si + xj, sj, idxCurrentPh);
+
+				// temporary stops
+				int stopsTerm =
+					getArrivals(si, si + xj, idxCurrentPh)
+					- max(0, getM(idxCurrentPh, xj)
+					- getQ(tables, si, idxCurrentPh, j - 1));
+
+				tStops = max(0, stopsTerm)
+					+ getArrivals(si + xj, sj, idxCurrentPh);
+
+
+				//NEW
+				/*
+				Calculate tp, function of sj and xj
+				*/
+				int tp = getArrivalEarliest(si, sj, xj, idxCurrentPh);
+
+				//    int tp = si + xj; // equals s_{j} - red
+				//    cout <<"(tp: "<< tp<<")";
+
+				// delay
+				int delayTerm = min(getQ(tables, si, idxCurrentPh, j - 1),
+					getM(idxCurrentPh, xj));
+
+				tDelay = getT(delayTerm, idxCurrentPh)
+					+ max(0, getQ(tables, si, idxCurrentPh, j - 1) -
+					getM(idxCurrentPh, xj))*(sj - si)
+					+ getB(tp, sj, idxCurrentPh);
 			}
-			for (unsigned int sj = red; sj <= T; sj++) {
-				
-				if(output)
-				cout << " " << sj;
 
-				X[j] = getFeasibleGreens(sj, j);
-				int xSz = X[j].size();
+			// record temporary queue lengths and stops
+			tables.tempQueue(index_xj, index_p, worker) = tQueue;
+			tables.tempStops(index_xj, index_p, worker) = tStops;
+
+			// PI Max Queue : use operator max
+			if (tQueue > pi_MaxQ) {
+				pi_MaxQ = tQueue;
+				index_maxPh = index_p;
+			}
 
-				L.resize(T);
-				S.resize(T);
-				for (unsigned int i = 0; i < T; ++i) {
-					L[i].resize(xSz);
-					S[i].resize(xSz);
+			// PI Stops & Delay : use operator +
+			pi_NumStops += tStops;
+			pi_Delay += tDelay;
 
-					for (int j = 0; j < xSz; ++j) {
-						L[i][j].resize(phases.size());
-						S[i][j].resize(phases.size());
+		} //end phaseSequence cycle
+
+		// index fix TODO: implications
+		if (j != 1 && si >= red){ // index fix to use si
+			si -= red;
+			//cout << "   si = " << si << " \n"; 
+		}
+
+		// objective fixed by the instantiation, folded at compile time
+		if (O == COP_QUEUES)
+			currentValueFn = max(pi_MaxQ, tables.value(j - 1, si));
+		else if (O == COP_STOPS)
+			currentValueFn = pi_NumStops + tables.value(j - 1, si);
+		else
+			currentValueFn = pi_Delay + tables.value(j - 1, si);
+
+		return currentValueFn;
+	}
+
+	/*
+	* Value function, decision and permanent queues of state sj at stage j.
+	* Reads only stage j - 1 tables, so states of one stage are independent.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::evaluateState(unsigned int j, unsigned int sj, unsigned int worker) {
+
+		int* X = ws.greens(worker);
+		int xSz = getFeasibleGreens(sj, j, X);
+		COP_PROFILED(profileCounts[worker].candidates += xSz);
+
+		if (pruning && j != 1 && xSz > 1)
+			settlePruned(j, sj, worker, X, xSz);
+		// greens after the leading 0 are consecutive, hand them to the vector kernel
+		else if (kernel != NULL && j != 1 && xSz > 2) {
+			CopCandidateInputs in;
+			CopCandidateResult best;
+			fillCandidateInputs(ws, Objective, j, sj, X[1], xSz - 1, in);
+			kernel(in, best);
+			settleState<Objective>(ws, j, sj, worker, X, xSz, &best);
+		}
+		else
+			settleState<Objective>(ws, j, sj, worker, X, xSz, NULL);
+
+		return xSz;
+	}
+
+	/*
+	* Lazy stage j: (j, T) and the states it reads, top-down through the
+	* stages before, that are not evaluated yet; then those bottom-up, each
+	* stage in its own phase. A state reads v_{j-1} of si (of si + red below
+	* red, the index fix) and the queues of si + red - 1 (getQ); below red
+	* the recovery goes on from red. Returns the states evaluated.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int Cop<NPhases, Objective>::evaluateDemanded(unsigned int j, int startPhase) {
+		const unsigned int n = T + 1;
+		unsigned int evaluated = 0;
+		int* X = ws.greens();
+
+		for (unsigned int k = 1; k <= j; k++)
+			lazyPending[k - 1].clear();
+		if (T < (unsigned int)red)
+			return 0;
+		lazyMarks[j * n + T] = 1;
+		lazyPending[j - 1].push_back(T);
+
+		for (unsigned int k = j; k > 1; k--) {
+			const vector<unsigned int>& pending = lazyPending[k - 1];
+			vector<unsigned int>& below = lazyPending[k - 2];
+			unsigned char* marks = &lazyMarks[(k - 1) * n];
+			for (unsigned int i = 0; i < pending.size(); i++) {
+				const int sj = pending[i];
+				const int xSz = getFeasibleGreens(sj, k, X);
+				for (int c = 0; c < xSz; c++) {
+					const int si = X[c] != 0 ? sj - X[c] - red : sj;
+					const int reads[3] = { si >= red ? si : si + red, si >= 1 ? si + red - 1 : 0, si < red ? red : 0 };
+					for (int r = 0; r < 3; r++) {
+						const int s = reads[r];
+						if (s >= red && s <= (int)T && !marks[s]) {
+							marks[s] = 1;
+							below.push_back(s);
+						}
 					}
 				}
+			}
+		}
 
-				Q.resize(T);
-				for (unsigned int i = 0; i < T; ++i) {
-					Q[i].resize(phases.size());
+		for (unsigned int k = 1; k <= j; k++) {
+			vector<unsigned int>& pending = lazyPending[k - 1];
+			if (pending.empty())
+				continue;
+			sort(pending.begin(), pending.end());
+			idxCurrentPh = (startPhase + k - 1) % NPhases;
+			if (pruning && k != 1)
+				buildMinTables(k);
+			for (unsigned int i = 0; i < pending.size(); i++)
+				evaluateState(k, pending[i], 0);
+			evaluated += (unsigned int)pending.size();
+		}
+		idxCurrentPh = (startPhase + j - 1) % NPhases;
+		return evaluated;
+	}
 
-					for (unsigned int j = 0; j < phases.size(); ++j)
-						Q[i][j].resize(M);
-				}
+	/*
+	* evaluateState for every objective still running, each against its own
+	* tables. While all of them run the candidate block is evaluated once
+	* for the three, sharing the feasible greens and the arrival terms.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::evaluateStates(unsigned int j, unsigned int sj, unsigned int worker) {
+
+		int* X = objectiveWs[COP_QUEUES].greens(worker);
+		int xSz = getFeasibleGreens(sj, j, X);
+		COP_PROFILED(profileCounts[worker].candidates += xSz);
+
+		bool useKernel = kernel != NULL && j != 1 && xSz > 2;
+		bool allRunning = true;
+		CopCandidateInputs in[COP_OBJECTIVE_COUNT];
+		CopCandidateResult best[COP_OBJECTIVE_COUNT];
+
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+			allRunning = allRunning && objectiveRunning[o];
+			if (useKernel && objectiveRunning[o])
+				fillCandidateInputs(objectiveWs[o], (CopObjective)o, j, sj, X[1], xSz - 1, in[o]);
+		}
 
-				int index_xj = 0;
-				int currentValueFn = -1;
-				int minValueFn = 99999;
-				int optimal_x = -1;
-				int optimal_index_x = -1;
+		if (useKernel && allRunning && multiKernel != NULL)
+			multiKernel(in, best);
+		else if (useKernel) {
+			for (int o = 0; o < COP_OBJECTIVE_COUNT; o++)
+				if (objectiveRunning[o])
+					kernel(in[o], best[o]);
+		}
 
-				for (vector<int>::iterator it = X[j].begin(); it != X[j].end(); ++it) {
-					int xj = *it;
+		if (objectiveRunning[COP_QUEUES])
+			settleState<COP_QUEUES>(objectiveWs[COP_QUEUES], j, sj, worker, X, xSz, useKernel ? &best[COP_QUEUES] : NULL);
+		if (objectiveRunning[COP_STOPS])
+			settleState<COP_STOPS>(objectiveWs[COP_STOPS], j, sj, worker, X, xSz, useKernel ? &best[COP_STOPS] : NULL);
+		if (objectiveRunning[COP_DELAY])
+			settleState<COP_DELAY>(objectiveWs[COP_DELAY], j, sj, worker, X, xSz, useKernel ? &best[COP_DELAY] : NULL);
 
-					int hj = (xj!=0) ? (xj+red) : 0; //transition value
+		return xSz;
+	}
 
-					// at stage 0, no steps allocated
-					int si = (j!=1) ? (sj-hj) : 0; // si equals s_{j-1}
-					//  cout << "\n hj, si: " <<hj << ", " << si<< "\n";
+	/*
+	* Minimises over the greens X of state sj, those from X[1] on already
+	* reduced to block when the kernel ran, and stores v, x* and Q in tables.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	template<CopObjective O>
+	void Cop<NPhases, Objective>::settleState(CopWorkspace& tables, unsigned int j, unsigned int sj, unsigned int worker, const int* X, int xSz, const CopCandidateResult* block) {
+
+		int index_xj = 0;
+		int currentValueFn = -1;
+		int minValueFn = INT_MAX; // was 99999, long horizons exceed it and left no optimal x
+		int optimal_x = -1;
+		int optimal_index_x = -1;
+		int scalarCount = block != NULL ? 1 : xSz;
+
+		for (; index_xj < scalarCount; index_xj++) {
+			int xj = X[index_xj];
+
+			currentValueFn = evaluateGreen<O>(tables, j, sj, xj, index_xj, worker);
+
+			//minimisation v_j : keep minimum value
+			if (minValueFn > currentValueFn) {
+				minValueFn = currentValueFn;
+				optimal_x = xj;
+				optimal_index_x = index_xj;
+			}
+		} // end X[j] cycle
 
-					int tQueue = 0;
-					int tStops = 0;
-					int tDelay = 0;
+		if (block != NULL && minValueFn > block->value) {
+			minValueFn = block->value;
+			optimal_index_x = block->index + 1;
+			optimal_x = X[optimal_index_x];
+			evaluateGreen<O>(tables, j, sj, optimal_x, optimal_index_x, worker); // queues of the winner only
+		}
 
-					int index_sj = sj - red; //index fix
-					int index_maxPh = -1;
+		storeState(tables, j, sj, worker, minValueFn, optimal_x, optimal_index_x);
+	}
 
-					//performance index calculation Max Q Length
-					// which phase has the longest temp queue?
-					int pi_MaxQ = -1;
-					int pi_NumStops = 0;
-					int pi_Delay = 0;
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::storeState(CopWorkspace& tables, unsigned int j, unsigned int sj, unsigned int worker, int value, int optimal_x, int optimal_index_x) {
 
-					for (unsigned int index_p = 0; index_p < phases.size(); index_p++) {
+		// sj - red :  adjust value to column index
+		tables.value(j, sj - red) = value;
+		tables.setDecision(j, sj - red, optimal_x);
+		if (sj == T)
+			tables.stageValue(j) = value;
 
-						if (index_p != idxCurrentPh) // phase w/o right-of-way
-						{
+		// -red and -1 deal, reconcile indices
 
-							int arrival = arrivalData[index_sj][index_p]; //
+		int optIndeX = 0; // stage 1 simplification
+		if (j != 1)
+			optIndeX = optimal_index_x;
 
-							// temporary queues
-							tQueue = getQ(si, index_p, j - 1)
-								+ getArrivals(si, sj, index_p);
+		// temporary to permanent queue lengths
+		for (unsigned int pp = 0; pp < NPhases; pp++)
+			tables.queue(sj - red, pp, j - 1) = tables.tempQueue(optIndeX, pp, worker); // -1 :index
 
-							// temporary stops
-							tStops = getArrivals(si, sj, index_p);
+		if (sj == T)
+			for (unsigned int pp = 0; pp < NPhases; pp++)
+				tables.stageQueue(j, pp) = tables.queue(sj - red, pp, j - 1);
+	}
 
-							//delay
-							tDelay = getQ(si, index_p, j - 1)*(sj - si)
-								+ getB(si, sj, index_p);
+	// sparse table over row[0..n), level l at l * stride holds minima of 2^l entries
+	static void buildRangeMin(int* table, unsigned int stride, const int* row, unsigned int n, unsigned int levels)
+	{
+		for (unsigned int k = 0; k < n; k++)
+			table[k] = row[k];
+		for (unsigned int l = 1; l < levels; l++) {
+			const int* below = table + (l - 1) * stride;
+			int* level = table + l * stride;
+			for (unsigned int k = 0; k + (1u << l) <= n; k++)
+				level[k] = min(below[k], below[k + (1u << (l - 1))]);
+		}
+	}
 
-						} else { //phase with right-of-way
+	// min of row[a..b], a <= b
+	static inline int rangeMin(const int* table, unsigned int stride, int a, int b)
+	{
+		int l = 0;
+		while ((2 << l) <= b - a + 1)
+			l++;
+		return min(table[l * stride + a], table[l * stride + b - (1 << l) + 1]);
+	}
 
-							// temporary queues
-							int queueTerm = getQ(si, idxCurrentPh, j - 1)
-								+ getArrivals(si, si + xj, idxCurrentPh)
-								- getM(idxCurrentPh, xj);
+	/*
+	* Range minima of stage j - 1 for the pruning bound: v_{j-1}, then the
+	* Q row of each phase as read by getQ(si, p, j - 1), all with stride T + 1
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::buildMinTables(unsigned int j) {
+		unsigned int n = T + 1;
+		minLevels = 1;
+		while ((2u << (minLevels - 1)) <= n)
+			minLevels++;
+
+		minTables.resize((NPhases + 1) * minLevels * n);
+		buildRangeMin(&minTables[0], n, &ws.value(j - 1, 0), T - red + 1, minLevels);
+		for (unsigned int p = 0; p < NPhases; p++)
+			buildRangeMin(&minTables[(p + 1) * minLevels * n], n, ws.queueRow(j - 2, p), n, minLevels);
+	}
 
-							tQueue = max(0, queueTerm) 
-								+ getArrivals(si + xj, sj, idxCurrentPh);
+	/*
+	* Least v_{j-1} read by any si in [siLow, siHigh], through the si -= red
+	* index fix: si < red reads v[si], the rest v[si - red].
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::minValue(int siLow, int siHigh) {
+		int least = INT_MAX;
+		if (siLow <= red - 1)
+			least = rangeMin(&minTables[0], T + 1, siLow, min(siHigh, red - 1));
+		if (siHigh >= red)
+			least = min(least, rangeMin(&minTables[0], T + 1, max(siLow, red) - red, siHigh - red));
+		return least;
+	}
 
-							// temporary stops
-							int stopsTerm =
-								getArrivals(si, si + xj, idxCurrentPh)
-								- max(0, getM(idxCurrentPh, xj)
-								- getQ(si, idxCurrentPh, j - 1));
+	/*
+	* Lower bound on the value of every green whose si lies in [siLow, siHigh].
+	* The phases without right-of-way cost at least their arrivals in [si, sj)
+	* and queues that are no shorter than the least one in the range; both
+	* only grow as si falls. fixedBound is the phase with right-of-way, the
+	* same for every green of sj.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::lowerBound(unsigned int sj, int siLow, int siHigh, int fixedBound) {
+		unsigned int n = T + 1;
+		int stage = fixedBound;
+		for (unsigned int p = 0; p < NPhases; p++) {
+			if (p == (unsigned int)idxCurrentPh)
+				continue;
+
+			if (Objective == COP_STOPS) {
+				stage += getArrivals(siHigh, sj, p);
+				continue;
+			}
 
-							tStops = max(0, stopsTerm)
-								+ getArrivals(si + xj, sj, idxCurrentPh);
+			int q = rangeMin(&minTables[(p + 1) * minLevels * n], n, siLow, siHigh);
+			if (Objective == COP_QUEUES)
+				stage = max(stage, q + getArrivals(siHigh, sj, p));
+			else
+				stage += q * ((int)sj - siHigh) + getB(siHigh, sj, p);
+		}
 
+		int v = minValue(siLow, siHigh);
+		return Objective == COP_QUEUES ? max(stage, v) : stage + v;
+	}
 
-							//NEW
-							/*
-							Calculate tp, function of sj and xj
-							*/
-							int tp = getArrivalEarliest(si, sj, xj, idxCurrentPh);
+	/*
+	* settleState for stages j > 1 with pruning. Greens come in falling si,
+	* so the ones left always span [siLow, si]; once their bound reaches the
+	* best value none of them can beat it. Ties keep the first green, as
+	* unpruned.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::settlePruned(unsigned int j, unsigned int sj, unsigned int worker, const int* X, int xSz) {
+
+		PruneCount& count = pruneCounts[worker];
+		int tp = sj - red;	// si + xj
+
+		// phase with right-of-way: arrivals after the green still stop and wait
+		int fixedBound;
+		if (Objective == COP_QUEUES || Objective == COP_STOPS)
+			fixedBound = getArrivals(tp, sj, idxCurrentPh);
+		else	// getT(d) >= the least time of the table, which only matters if that is negative
+			fixedBound = getB(tp, sj, idxCurrentPh) + dischargeTimeMin[idxCurrentPh];
+
+		int minValueFn = evaluateGreen<Objective>(ws, j, sj, X[0], 0, worker);	// xj = 0
+		int optimal_x = X[0];
+		int optimal_index_x = 0;
+		count.candidates += xSz - 1;
+
+		CopCandidateInputs in;
+		CopCandidateResult best;
+		if (kernel != NULL)
+			fillCandidateInputs(ws, Objective, j, sj, X[1], 0, in);
+
+		int siLow = tp - X[xSz - 1];	// of the last green
+		int index_xj = 1;
+		while (index_xj < xSz) {
+			if (lowerBound(sj, siLow, tp - X[index_xj], fixedBound) >= minValueFn) {
+				count.pruned += xSz - index_xj;
+				break;
+			}
 
-							//    int tp = si + xj; // equals s_{j} - red
-							//    cout <<"(tp: "<< tp<<")";
+			// a block of greens between checks of the bound
+			int n = min(16, xSz - index_xj);
+			if (kernel != NULL) {
+				in.firstGreen = X[index_xj];
+				in.count = n;
+				kernel(in, best);
+				if (minValueFn > best.value) {
+					minValueFn = best.value;
+					optimal_index_x = index_xj + best.index;
+					optimal_x = X[optimal_index_x];
+				}
+			}
+			else
+			for (int k = index_xj; k < index_xj + n; k++) {
+				// per green only where queues tighten the bound, it costs about an evaluation
+				if (Objective != COP_STOPS && lowerBound(sj, tp - X[k], tp - X[k], fixedBound) >= minValueFn) {
+					count.pruned++;
+					continue;
+				}
 
-							// delay
-							int delayTerm = min(getQ(si, idxCurrentPh, j - 1),
-								getM(idxCurrentPh, xj));
+				int currentValueFn = evaluateGreen<Objective>(ws, j, sj, X[k], k, worker);
+				if (minValueFn > currentValueFn) {
+					minValueFn = currentValueFn;
+					optimal_x = X[k];
+					optimal_index_x = k;
+				}
+			}
+			index_xj += n;
+		}
 
-							tDelay = getT(delayTerm, idxCurrentPh)
-								+ max(0, getQ(si, idxCurrentPh, j - 1) -
-								getM(idxCurrentPh, xj))*(sj - si)
-								+ getB(tp, sj, idxCurrentPh);
-						}
+		if (kernel != NULL && optimal_index_x != 0)
+			evaluateGreen<Objective>(ws, j, sj, optimal_x, optimal_index_x, worker); // queues of the winner only
 
-						// record temporary queue lengths and stops
-						L[index_sj][index_xj][index_p] = tQueue;
-						S[index_sj][index_xj][index_p] = tStops;
+		storeState(ws, j, sj, worker, minValueFn, optimal_x, optimal_index_x);
+	}
 
-						// PI Max Queue : use operator max
-						if (tQueue > pi_MaxQ) {
-							pi_MaxQ = tQueue;
-							index_maxPh = index_p;
-						}
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::fillCandidateInputs(CopWorkspace& tables, CopObjective objective, unsigned int j, unsigned int sj, int firstGreen, int count, CopCandidateInputs& in) {
+		in.sj = sj;
+		in.red = red;
+		in.firstGreen = firstGreen;
+		in.count = count;
+		in.nPhases = NPhases;
+		in.current = idxCurrentPh;
+		in.objective = objective;
+		in.discharged = &dischargeVehicles[idxCurrentPh][0];
+		in.dischargeTimes = &dischargeTimes[idxCurrentPh][0];
+		in.dischargeLast = (int)dischargeTimes[idxCurrentPh].size() - 1;
+		in.values = &tables.value(j - 1, 0);
+
+		for (unsigned int p = 0; p < NPhases; p++) {
+			in.queues[p] = tables.queueRow(j - 2, p);
+			in.cumArrivals[p] = &cumArrivals[p][0];
+			in.cumRequests[p] = &cumRequests[p][0];
+			in.cumRequestTimes[p] = &cumRequestTimes[p][0];
+		}
+	}
 
-						// PI Stops & Delay : use operator +
-						pi_NumStops += tStops;
-						pi_Delay += tDelay;
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::StageSweep::execute(unsigned int worker, unsigned int begin, unsigned int end) {
+		COP_PROFILED(unsigned long long* outer = profileCalls);
+		COP_PROFILED(profileCalls = cop->profileCounts[worker].calls);
+		for (unsigned int i = begin; i < end; i++) {
+			if (all)
+				cop->evaluateStates(j, first + i, worker);
+			else
+				cop->evaluateState(j, first + i, worker);
+		}
+		COP_PROFILED(profileCalls = outer);
+	}
 
-					} //end phaseSequence cycle
+	/*
+	* Counters of a solve: zeroed by profileBegin, one stage record per
+	* stage run, summed over the workers by profileEnd.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::profileBegin() {
+#if COP_PROFILING
+		profile.clear();
+		profile.stages.reserve(M);
+		profileCounts.resize(max(threads, 1));
+		for (unsigned int w = 0; w < profileCounts.size(); w++) {
+			for (int c = 0; c < COP_CALL_COUNT; c++)
+				profileCounts[w].calls[c] = 0;
+			profileCounts[w].candidates = 0;
+		}
+		profileOuter = profileCalls;
+		profileCalls = profileCounts[0].calls;	// the solving thread is worker 0
+#endif
+	}
 
-					// index fix TODO: implications
-					if (j != 1 && si >= red){ // index fix to use si
-						si -= red;
-						//cout << "   si = " << si << " \n"; 
-					}
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::profileStage(unsigned int j, unsigned int states, chrono::steady_clock::time_point begun) {
+#if COP_PROFILING
+		unsigned long long candidates = 0;
+		for (unsigned int w = 0; w < profileCounts.size(); w++)
+			candidates += profileCounts[w].candidates;
+
+		CopStageProfile stage;
+		stage.stage = j;
+		stage.seconds = chrono::duration<double>(chrono::steady_clock::now() - begun).count();
+		stage.states = states;
+		stage.candidates = candidates - profile.candidates;
+		profile.stages.push_back(stage);
+		profile.states += states;
+		profile.candidates = candidates;
+#endif
+	}
 
-					switch (PI) {
-					case QUEUES:
-						currentValueFn = max(pi_MaxQ, v[j - 1][si]);
-						break;
-					case STOPS:
-						currentValueFn = pi_NumStops + v[j - 1][si];
-						break;
-					case DELAY:
-						currentValueFn = pi_Delay + v[j - 1][si];
-						break;
-					}
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::profileEnd(chrono::steady_clock::time_point started, size_t allocated) {
+#if COP_PROFILING
+		for (unsigned int w = 0; w < profileCounts.size(); w++)
+			for (int c = 0; c < COP_CALL_COUNT; c++)
+				profile.calls[c] += profileCounts[w].calls[c];
+		profileCalls = profileOuter;
+
+		profile.workspaceBytes = ws.bytes();
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++)
+			profile.workspaceBytes += objectiveWs[o].bytes();
+		profile.peakWorkspaceBytes = max(profile.peakWorkspaceBytes, profile.workspaceBytes);
+		profile.bytesAllocated = allocated;
+		profile.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+#endif
+	}
 
-					//minimisation v_j : keep minimum value
-					if (minValueFn > currentValueFn) {
-						minValueFn = currentValueFn;
-						optimal_x = xj;
-						optimal_index_x = index_xj;
-					}
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> Cop<NPhases, Objective>::RunCOP() {
+		solve();
+		return result.sequence;
+	}
 
-					index_xj++;
-				} // end X[j] cycle
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::solve() {
+		return solve(chrono::steady_clock::time_point::max());
+	}
 
-				// sj - red :  adjust value to column index
-				v[j][sj - red] = minValueFn;
-				x_star[j][sj - red] = optimal_x;
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::solve(chrono::steady_clock::time_point deadline) {
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		const bool bounded = deadline != chrono::steady_clock::time_point::max();
+		chrono::steady_clock::time_point stageStarted = started;
+		bool deadlineHit = false;
+		buildDischargeTables();
+		profileBegin();
+
+		const bool banded = !bandLow.empty();
+		const bool demanded = lazy && !banded && !longHorizon && !trace;
+		const int startPhase = idxCurrentPh;
+
+		// same inputs as a cached solve: its result, and the phase it ended on
+		if (cache && !banded) {
+			buildCacheKey();
+			int endPhase;
+			if (cache->find(cacheKey, result, endPhase)) {
+				idxCurrentPh = endPhase;
+				result.stats.cached = true;
+				result.stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+				profileEnd(started, 0);
+				if (trace)
+					*trace << "COP result from cache\n";
+				return (int)result.sequence.size();
+			}
+		}
+		result.stats.cached = false;
+
+		if (trace) {
+			*trace << "COP started...\n";
+			*trace << "\n\nInput Arrival Data: ";
+			//printArrivals();
+		}
 
-				// -red and -1 deal, reconcile indices
+		bool fresh = reserveWorkspace();	// allocates only when M, T, greens or phases grow
+		int* X = ws.greens();
+
+		if (threads > 1 && (!pool || pool->size() != (unsigned int)threads))
+			pool = std::make_shared<CopThreadPool>(threads);
+
+		// warm start: keep the states computed before the first changed arrival
+		WarmKey key = getWarmKey();
+		warmStats.firstChange = min(firstChange, T);
+		warmStats.statesReused = warmStats.statesComputed = 0;
+		warmStats.warm = warmStart && !longHorizon && !banded && !demanded && !fresh && warmStages > 0 && sameWarmKey(key, warmKey)
+			&& warmStats.firstChange >= warmMinReuse * T;
+
+		if (!warmStats.warm)
+			initMatrices(-1);
+		if (pruning) {
+			pruneCounts.resize(threads);
+			for (int w = 0; w < threads; w++)
+				pruneCounts[w].candidates = pruneCounts[w].pruned = 0;
+		}
+		if (demanded) {
+			lazyMarks.assign(M * (T + 1), 0);
+			lazyPending.resize(M);
+		}
+		unsigned int j = 1;
+		bool criterion_flag = 1;
 
-				int optIndeX = 0; // stage 1 simplification
-				if (j != 1)
-					optIndeX = optimal_index_x;
+		do {
+			COP_PROFILED(const chrono::steady_clock::time_point stageBegun = chrono::steady_clock::now());
+			if(trace){
+				// <editor-fold defaultstate="collapsed" desc="header stage">
+				*trace << endl << "\n\t\t\tStage " << j << " Calculations [" << phaseSeq[idxCurrentPh] << "]" << endl;
+				*trace << "--------------------------------------------------------------------" << endl;
+				*trace << "s" << j << "\tx*(s" << j << ")\tv(s" << j << ")";
+				for (unsigned int pp = 0; pp < NPhases; pp++)
+					*trace << "\tQ" << phaseSeq[pp];
+				*trace << "\tXj(s" << j << ")\n";
+				*trace << "--------------------------------------------------------------------"<< endl;
+				// </editor-fold>
+			}
+			unsigned int first = max(red, getWarmBound(j) + 1);
+			unsigned int last = T;
+			warmStats.statesReused += first - red;
+
+			// banded: states outside are out of reach and hold no queues. getQ reads
+			// those of a state up to red - 1 above (under 2 red, one below) the one
+			// it was given, so these are evaluated too, then made unreachable.
+			// Stages past the band evaluate every state
+			unsigned int low = first, high = last;
+			if (banded && j <= bandLow.size()) {
+				low = max(first, (unsigned int)max(0, bandLow[j - 1]));
+				high = min(last, (unsigned int)max(0, bandHigh[j - 1]));
+				first = low > first ? low - 1 : low;
+				last = min(last, high + red - 1);
+				for (unsigned int s = 0; s < T; s++) {
+					ws.value(j, s) = unreachable;
+					ws.setDecision(j, s, 0);
+					for (unsigned int pp = 0; pp < NPhases; pp++)
+						ws.queue(s, pp, j - 1) = 0;
+				}
+				ws.stageValue(j) = unreachable;	// until T is in the band
+			}
+			const unsigned int states = demanded ? evaluateDemanded(j, startPhase) : first <= last ? last - first + 1 : 0;
+			warmStats.statesComputed += states;
 
-				// temporary to permanent queue lengths
-				for (unsigned int pp = 0; pp < phases.size(); pp++)
-					Q[sj - red][pp][j - 1] = L[sj - red][optIndeX][pp]; // -1 :index
+			if (pruning && j != 1 && !demanded)
+				buildMinTables(j);
+
+			if (demanded)
+				;	// evaluated above, top-down
+			else if (pool && !trace && states > 0) {	// trace needs the states in order, keep it serial
+				StageSweep sweep(this, j, first);
+				pool->run(sweep, states);
+			}
+			else
+			for (unsigned int sj = first; sj <= last; sj++) {
+				
+				if(trace)
+				*trace << " " << sj;
+
+				int xSz = evaluateState(j, sj, 0);
 
 				/**print*************************/
-				if(output){
-					cout << "\t" << optimal_x;
-					cout << "\t" << v[j][sj - red];
+				if(trace){
+					*trace << "\t" << ws.decision(j, sj - red);
+					*trace << "\t" << ws.value(j, sj - red);
 				
-					for (unsigned int pp = 0; pp < phases.size(); pp++)
-						cout << "\t" << Q[sj - red][pp][j - 1];
+					for (unsigned int pp = 0; pp < NPhases; pp++)
+						*trace << "\t" << ws.queue(sj - red, pp, j - 1);
 
-					cout << setfill(' ') << setw(30 - 2 * L.size());
-					cout.flush();
-					printVector(X[j]);
-					cout << endl;
+					*trace << setfill(' ') << setw(30 - 2 * T);
+					trace->flush();
+					printVector(vector<int>(X, X + xSz));
+					*trace << endl;
 				if (sj % 2 == 0)
-					cout << endl;
+					*trace << endl;
 				}
 
 				// </editor-fold>
 				/**print*************************/
 
 			} //end sj cycle
+			for (unsigned int s = first; s <= last; s++) {
+				if (s < low || s > high) {
+					ws.value(j, s - red) = unreachable;
+					ws.setDecision(j, s - red, 0);
+				}
+			}
+			COP_PROFILED(profileStage(j, states, stageBegun));
 
 			//************ STOPPING CRITERION ***********
 			//if(criterion_flag)
 			//{ 
-			if (j >= phases.size()) {
-				for (unsigned int k = 1; k <= phases.size() - 1; k++) {
-					criterion_flag = criterion_flag && (v[j - k][T- red] == v[j][T - red]);
+			// banded, v_j(T) is known from the last band entry on
+			if (j >= NPhases && (!banded || j >= bandLow.size() + NPhases - 1)) {
+				for (unsigned int k = 1; k <= NPhases - 1; k++) {
+					criterion_flag = criterion_flag && (ws.stageValue(j - k) == ws.stageValue(j));
 				}
 
 				criterion_flag = !criterion_flag;
-				idxCurrentPh = idxCurrentPh==2 ? 0:idxCurrentPh + 1;
+				idxCurrentPh = nextPhase(idxCurrentPh);
 				if (criterion_flag)
 				{
 					//Updates index of current phase in cycles
@@ -684,43 +1746,138 @@ namespace COP97A{
 			}
 			else
 			{
-				idxCurrentPh = idxCurrentPh==2 ? 0:idxCurrentPh + 1;
+				idxCurrentPh = nextPhase(idxCurrentPh);
 				j++;
 			}
 			//}
-		} while (criterion_flag && j < M); // NEW: second condition
 
-		if (output){
-			cout << "\nStopping Criterion Triggered!\n";
-			cout << "\n\nValue Functions for all Stages v(j,sj)\n\n";
-			printMatrix(v);
-			cout << "\nDecision Table for all Stages x*(j, sj)\n\n";
-			printMatrix(x_star);
+			// anytime: stop once the next stage, taking as long as this one, would overrun
+			if (bounded && criterion_flag && j < M) {
+				chrono::steady_clock::time_point now = chrono::steady_clock::now();
+				deadlineHit = now + (now - stageStarted) > deadline;
+				stageStarted = now;
+			}
+		} while (criterion_flag && j < M && !deadlineHit); // NEW: second condition
+
+		// tables now match the arrivals for every stage run
+		const unsigned int stages = criterion_flag ? j - 1 : j;
+		warmStages = banded || demanded ? 0 : stages;	// states outside the band, or not demanded, were skipped
+		warmKey = key;
+		firstChange = UINT_MAX;
+
+		result.stats.stages = stages;
+		result.stats.candidates = result.stats.pruned = 0;
+		if (pruning) {
+			for (int w = 0; w < threads; w++) {
+				result.stats.candidates += pruneCounts[w].candidates;
+				result.stats.pruned += pruneCounts[w].pruned;
+			}
+		}
+		result.stats.converged = !criterion_flag;
+		result.stats.deadlineHit = deadlineHit;
+		result.stats.states = warmStats.statesComputed;
+		const double all = (double)stages * max(0, (int)T - red + 1);
+		result.stats.skipped = demanded && all > 0 ? 1.0 - warmStats.statesComputed / all : 0;
+
+		if (trace && deadlineHit)
+			*trace << "\nDeadline reached after " << warmStages << " stages\n";
+		if (trace){
+			*trace << "\nStopping Criterion Triggered!\n";
+			if (!longHorizon) {	// rolling rows, only the last stages are left
+				*trace << "\n\nValue Functions for all Stages v(j,sj)\n\n";
+				printMatrix(ws.getValues(M, T));
+			}
+			*trace << "\nDecision Table for all Stages x*(j, sj)\n\n";
+			printMatrix(ws.getDecisions(M, T));
 		}
 
 		/*  Retrieval of Optimal Policy     */
 		// cout << endl << "j :"<< j  <<endl;
 
-		const int jsize = j - (phases.size() - 1);
-		int s_star= T;
+		// cut short: recover from the deepest completed stage
+		const int jsize = deadlineHit ? j - 1 : j - (NPhases - 1);
 
 		//cout << endl << "jsize :"<< jsize  <<endl;
+
+		recoverSequence(ws, jsize, result);
+		if (trace) {
+			*trace << "\nOptimal Control Sequence: \n\n"; 
+			printControl(ws.sequence(), jsize);
+			*trace << "\n\n...COP ended\n\n";
+		}
+		result.stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		profileEnd(started, fresh ? ws.bytes() : 0);
+		if (cache && !deadlineHit && !banded)	// a cut short sequence depends on timing, not only the inputs
+			cache->insert(cacheKey, result, idxCurrentPh);
+		return jsize;
+
+
+	}; /**************** END MAIN*************/
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::solve(const int* data, unsigned int slots, CopSolveContext<NPhases, Objective>& context, chrono::steady_clock::time_point deadline) const {
+		// everything written is the context's
+		Cop& solver = context.solver;
+		solver.configure(*this);
+		solver.idxCurrentPh = solver.initialPhase = context.phase >= 0 ? context.phase : initialPhase;
+		solver.setArrivals(data, slots);
+		return solver.solve(deadline);
+	}
+
+	/*
+	* Parameters and options of config, for a solve in a context. Only what
+	* differs is set, so the discharge tables are sampled again and the warm
+	* start is dropped only when config changed. The trace stays off.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::configure(const Cop& config) {
+		if (T != config.T)
+			setHorizon(config.T);
+		red = config.red;
+		mingreen = config.mingreen;
+		maxgreen = config.maxgreen;
+		M = config.M;
+		if (startupLostTime != config.startupLostTime)
+			setStartupLostTime(config.startupLostTime);
+		for (unsigned int p = 0; p < NPhases; p++) {
+			if (satFlows[p] != config.satFlows[p])
+				setSaturationFlow(p, config.satFlows[p]);
+			if (lanePhases[p] != config.lanePhases[p])
+				setLanePhases(p, config.lanePhases[p]);
+		}
+		if (dischargeProfile != config.dischargeProfile)
+			setDischargeProfile(config.dischargeProfile);
+
+		if (threads != config.threads)
+			setThreads(config.threads);
+		kernel = config.kernel;
+		multiKernel = config.multiKernel;
+		pruning = config.pruning;
+		longHorizon = config.longHorizon;
+		lazy = config.lazy;
+		warmStart = config.warmStart;
+		warmMinReuse = config.warmMinReuse;
+		cache = config.cache;
+		bandLow = config.bandLow;
+		bandHigh = config.bandHigh;
+	}
+
+	/*
+	* Backtracks x* from s_T at stage jsize into out
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void Cop<NPhases, Objective>::recoverSequence(CopWorkspace& tables, int jsize, CopResult& out) {
+
+		int s_star= T;
 		//cout << endl << "s* :"<< s_star  <<endl;
 
-		//new
-		//int idxSeq = initialPhase;
-		int idxSeq = idxCurrentPh;
-		//string controlSeq = "[ ";
-		//cout << "[ ";
 		//int optimalControlSeq [jsize];
-		int* optimalControlSeq = new int[jsize];
+		int* optimalControlSeq = tables.sequence();
 
 		for(int jj= jsize; jj>=1; jj--)
 		{
-			//cout <<"jsize "<< jsize;
 			//cout <<"*jj, s_star-red = "<< jj <<", "<<s_star-red<<endl; 
-			int xx = x_star[jj][s_star-red];
-			//cout <<"jj, s_star-red = "<< jj <<", "<<s_star-red << " = " << xx<<endl;
+			int xx = tables.decision(jj, s_star-red);
 			optimalControlSeq[jj-1] = xx;
 
 			if (jj > 1) {
@@ -729,17 +1886,163 @@ namespace COP97A{
 				//s_star = (s_star <= red) ? red : s_star - hj_star;
 				if (s_star <= red) s_star = red;
 			}
+		}
+
+		out.sequence.assign(optimalControlSeq, optimalControlSeq + jsize); // reuses capacity
+		out.value = jsize > 0 ? tables.stageValue(jsize) : 0;
+		out.queues.clear();
+		for (unsigned int pp = 0; pp < NPhases; pp++)
+			out.queues.push_back(jsize > 0 ? tables.stageQueue(jsize, pp) : 0);
+	}
 
-			idxSeq = idxSeq==0 ? 2:idxSeq - 1;
+	/*
+	* One sweep for all objectives: each keeps its own v, x* and Q tables and
+	* stopping criterion and drops out of the sweep once it stops. The phase
+	* advances by the stages of the longest, as after that solve on its own.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int Cop<NPhases, Objective>::solveAll() {
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		buildDischargeTables();
+		profileBegin();
+
+		size_t allocated = 0;
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+			objectiveResults[o].sequence.reserve(M);
+			objectiveResults[o].queues.reserve(NPhases);
+			if (objectiveWs[o].reserve(M, T, getMaxCandidates(), NPhases, threads))
+				allocated += objectiveWs[o].bytes();
+			initTables(objectiveWs[o], -1);
 		}
-		//cout << "]\n";
-		
-		cout << "\nOptimal Control Sequence: \n\n"; 
-		optControlSequence = printSequence(optimalControlSeq, jsize);
-		delete optimalControlSeq;
-		cout << "\n\n...COP ended\n\n";
-		return optControlSequence;
 
+		if (threads > 1 && (!pool || pool->size() != (unsigned int)threads))
+			pool = std::make_shared<CopThreadPool>(threads);
 
-	}; /**************** END MAIN*************/
+		unsigned int stages[COP_OBJECTIVE_COUNT];
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+			objectiveRunning[o] = true;
+			stages[o] = 0;
+		}
+		int running = COP_OBJECTIVE_COUNT;
+		unsigned int j = 1;
+
+		do {
+			COP_PROFILED(const chrono::steady_clock::time_point stageBegun = chrono::steady_clock::now());
+			if (pool) {
+				StageSweep sweep(this, j, red, true);
+				pool->run(sweep, T - red + 1);
+			}
+			else
+			for (unsigned int sj = red; sj <= T; sj++)
+				evaluateStates(j, sj, 0);
+			COP_PROFILED(profileStage(j, T - red + 1, stageBegun));
+
+			// same stopping criterion as solve, per objective
+			if (j >= NPhases) {
+				for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+					if (!objectiveRunning[o])
+						continue;
+
+					bool criterion = true;
+					for (unsigned int k = 1; k <= NPhases - 1; k++)
+						criterion = criterion && (objectiveWs[o].stageValue(j - k) == objectiveWs[o].stageValue(j));
+
+					if (criterion) {
+						objectiveRunning[o] = false;
+						stages[o] = j;
+						running--;
+					}
+				}
+			}
+
+			idxCurrentPh = nextPhase(idxCurrentPh);
+			if (running > 0)
+				j++;
+		} while (running > 0 && j < M);
+
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		profileEnd(started, allocated);
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+			CopResult& out = objectiveResults[o];
+			bool converged = !objectiveRunning[o];
+			recoverSequence(objectiveWs[o], (converged ? stages[o] : j) - (NPhases - 1), out);
+			out.stats.stages = converged ? stages[o] : j - 1;
+			out.stats.converged = converged;
+			out.stats.deadlineHit = false;
+			out.stats.candidates = out.stats.pruned = 0;
+			out.stats.states = out.stats.stages * (unsigned int)max(0, (int)T - red + 1);
+			out.stats.skipped = 0;
+			out.stats.seconds = seconds;
+
+			if (trace) {
+				*trace << "\nOptimal Control Sequence (" << (o == COP_QUEUES ? "queues" : o == COP_STOPS ? "stops" : "delay") << "): \n\n";
+				printControl(objectiveWs[o].sequence(), (int)out.sequence.size());
+				*trace << "\n";
+			}
+		}
+
+		return (int)objectiveResults[Objective].sequence.size();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopSolveContext<NPhases, Objective>::CopSolveContext()
+		: solver(0, 10), phase(-1)
+	{
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSolveContext<NPhases, Objective>::setInitialPhase(int p)
+	{
+		phase = p;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopResult& CopSolveContext<NPhases, Objective>::getResult()
+	{
+		return solver.getResult();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopSolveContext<NPhases, Objective>::getOptimalControl(int out[], int capacity)
+	{
+		return solver.getOptimalControl(out, capacity);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopWarmStats CopSolveContext<NPhases, Objective>::getWarmStartStats()
+	{
+		return solver.getWarmStartStats();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopProfile& CopSolveContext<NPhases, Objective>::getProfile()
+	{
+		return solver.getProfile();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	size_t CopSolveContext<NPhases, Objective>::getWorkspaceBytes()
+	{
+		return solver.getWorkspaceBytes();
+	}
+
+	/* instantiations exported by the DLL */
+	template class Cop<2, COP_QUEUES>;
+	template class Cop<2, COP_STOPS>;
+	template class Cop<2, COP_DELAY>;
+	template class Cop<3, COP_QUEUES>;
+	template class Cop<3, COP_STOPS>;
+	template class Cop<3, COP_DELAY>;
+	template class Cop<4, COP_QUEUES>;
+	template class Cop<4, COP_STOPS>;
+	template class Cop<4, COP_DELAY>;
+	template class CopSolveContext<2, COP_QUEUES>;
+	template class CopSolveContext<2, COP_STOPS>;
+	template class CopSolveContext<2, COP_DELAY>;
+	template class CopSolveContext<3, COP_QUEUES>;
+	template class CopSolveContext<3, COP_STOPS>;
+	template class CopSolveContext<3, COP_DELAY>;
+	template class CopSolveContext<4, COP_QUEUES>;
+	template class CopSolveContext<4, COP_STOPS>;
+	template class CopSolveContext<4, COP_DELAY>;
 }
\ No newline at end of file
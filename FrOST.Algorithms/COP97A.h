@@ -16,64 +16,319 @@ namespace std {
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <random>
+#include "CopThreadPool.h"
+#include "CopKernel.h"
+#include "CopProfile.h"
 
 //using namespace System;
 
 namespace COP97A {
 
-	class Cop97A
+	/*
+	* Storage for the tables of one COP run, kept in a single block so that
+	* repeated calls to RunCOP reuse it instead of allocating. Tables are laid
+	* out with the capacity dimensions, which only ever grow.
+	*
+	* Rolling tables keep only the value and queue rows of stage 0 and of the
+	* last two stages, all the recursion reads, and v_j(T), Q_j(T) of every stage.
+	* Decisions, the only full table then, take decisionBytes each.
+	*/
+	class CopWorkspace
+	{
+	public:
+		COP97A_API CopWorkspace();
+		COP97A_API bool reserve(unsigned int stages, unsigned int horizon, unsigned int candidates, unsigned int nPhases, unsigned int workers = 1,
+			bool rolling = false, unsigned int decisionBytes = sizeof(int));
+		COP97A_API size_t bytes();	// held by the tables
+		COP97A_API bool isRolling();
+		COP97A_API std::vector<std::vector<int> > getValues(unsigned int stages, unsigned int horizon);
+		COP97A_API std::vector<std::vector<int> > getDecisions(unsigned int stages, unsigned int horizon);
+
+		// v_j(s_j)
+		inline int& value(unsigned int j, unsigned int s) { return buffer[vOffset + row(j) * horizon + s]; }
+		// x*_j(s_j)
+		inline int decision(unsigned int j, unsigned int s) {
+			const unsigned char* at = &decisions[(j * horizon + s) * decisionBytes];
+			if (decisionBytes == 1)
+				return *at;
+			if (decisionBytes == 2) {
+				uint16_t x;
+				memcpy(&x, at, sizeof(x));
+				return x;
+			}
+			int x;
+			memcpy(&x, at, sizeof(x));
+			return x;
+		}
+		inline void setDecision(unsigned int j, unsigned int s, int x) {
+			unsigned char* at = &decisions[(j * horizon + s) * decisionBytes];
+			if (decisionBytes == 1)
+				*at = (unsigned char)x;
+			else if (decisionBytes == 2) {
+				uint16_t narrow = (uint16_t)x;
+				memcpy(at, &narrow, sizeof(narrow));
+			}
+			else
+				memcpy(at, &x, sizeof(x));
+		}
+		// Q_{phi, j}(s_j), rows over s_j shifted by one so that row[0] stays 0
+		inline int& queue(unsigned int s, unsigned int phi, unsigned int j) { return buffer[qOffset + (row(j) * nPhases + phi) * (horizon + 1) + s + 1]; }
+		// row[si] == getQ(si, phi, j + 1)
+		inline const int* queueRow(unsigned int j, unsigned int phi) { return &buffer[qOffset + (row(j) * nPhases + phi) * (horizon + 1)]; }
+		// v_j(T) and Q_{phi, j}(T), kept for every stage
+		inline int& stageValue(unsigned int j) { return buffer[fOffset + j]; }
+		inline int& stageQueue(unsigned int j, unsigned int phi) { return buffer[fOffset + stages + j * nPhases + phi]; }
+		// L_{phi, j}(s_j, x_j) for the state being evaluated by worker w
+		inline int& tempQueue(unsigned int x, unsigned int phi, unsigned int w = 0) { return buffer[lOffset + (w * candidates + x) * nPhases + phi]; }
+		// S_{sigma, j}(s_j, x_j) for the state being evaluated by worker w
+		inline int& tempStops(unsigned int x, unsigned int phi, unsigned int w = 0) { return buffer[sOffset + (w * candidates + x) * nPhases + phi]; }
+		// X_j(s_j) for the state being evaluated by worker w
+		inline int* greens(unsigned int w = 0) { return &buffer[gOffset + w * candidates]; }
+		// recovered control sequence
+		inline int* sequence() { return &buffer[seqOffset]; }
+
+	private:
+		unsigned int stages;
+		unsigned int horizon;
+		unsigned int candidates;
+		unsigned int nPhases;
+		unsigned int workers;
+		bool rolling;
+		unsigned int decisionBytes;
+		size_t vOffset, qOffset, lOffset, sOffset, gOffset, seqOffset, fOffset;
+		std::vector<int> buffer;
+		std::vector<unsigned char> decisions;
+
+		// value and queue row of stage j
+		inline unsigned int row(unsigned int j) { return !rolling ? j : j == 0 ? 0 : 1 + (j & 1); }
+	};
+
+	/*
+	* What the last solve reused from the one before, see setWarmStart. Warm
+	* start is for offline re-solves of one horizon start, what-if runs and
+	* sweeps that change later arrivals. A rolling horizon shifts every slot,
+	* so it changes from slot 0 on and always gets a full solve.
+	*/
+	struct CopWarmStats
+	{
+		bool warm;					// false: full solve
+		unsigned int firstChange;	// first arrival slot changed since the previous solve
+		unsigned int statesReused;	// (j, sj) taken from the previous tables
+		unsigned int statesComputed;
+	};
+
+	/*
+	* How the last solve ended, see solve(deadline)
+	*/
+	struct CopSolveStats
+	{
+		unsigned int stages;	// stages completed
+		bool converged;			// stopping criterion fired
+		bool deadlineHit;		// stopped by the deadline before converging or reaching M
+		double seconds;			// wall time of the solve
+		unsigned int candidates;	// greens of stages j > 1, counted with pruning on
+		unsigned int pruned;		// of those, skipped as unable to beat the best
+		bool cached;			// taken from the result cache, see setResultCache
+		unsigned int states;	// (j, sj) evaluated
+		double skipped;			// lazy: fraction of the (j, sj) of the stages run never evaluated, see setLazy
+	};
+
+	/*
+	* Outcome of the last solve, filled in place so that repeated solves reuse it
+	*/
+	struct CopResult
+	{
+		std::vector<int> sequence;	// greens from the current phase on, 0 = phase skipped
+		int value;					// v_j(T) of the stage the sequence was recovered from
+		std::vector<int> queues;	// per phase, permanent queue at the end of the horizon
+		CopSolveStats stats;
+	};
+
+	class CopResultCache;
+
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopSolveContext;
+
+	/*
+	* Parameters of one junction, defaults as Cop::initParameters. Cop::configure
+	* sets all but the horizon, which the caller lays out the arrivals for
+	*/
+	struct CopJunction
+	{
+		int initialPhase;
+		int red;
+		int mingreen;
+		int maxgreen;
+		float lostTime;
+		unsigned int horizon;
+		unsigned int maxPhases;					// M, see Cop::setMaxPhCompute
+		float satFlows[COP_MAX_PHASES];			// per phase, <= 0 if unset
+		int lanes[COP_MAX_PHASES];				// per phase
+
+		CopJunction() : initialPhase(0), red(1), mingreen(2), maxgreen(50), lostTime(0), horizon(10), maxPhases(9)
+		{
+			for (int p = 0; p < COP_MAX_PHASES; p++) {
+				satFlows[p] = -1.0f;
+				lanes[p] = 1;
+			}
+		}
+	};
+
+	// [0, 1) from the top 24 bits of a draw, the same on every platform
+	inline float uniformDraw(std::mt19937& random)
+	{
+		return (random() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	/*
+	* Discharge of the phase with right-of-way. Cop samples a profile into
+	* per-phase tables when the saturation flows, lanes, lost time or the
+	* profile change, so the recursion only ever reads the tables and a
+	* profile may cost what it likes. It must depend on its arguments only.
+	* satRate is vehicles per step of the whole phase, <= 0 if unset.
+	*/
+	class CopDischargeProfile
+	{
+	public:
+		virtual ~CopDischargeProfile() {}
+		virtual int getM(int phi, int xj, float satRate, float lostTime) = 0;	// vehicles cleared in a green of xj > 0
+		virtual int getT(int d, int phi, float satRate, float lostTime) = 0;	// steps to clear d > 0 queued vehicles
+	};
+
+	/*
+	* M = floor(s * x), T = ceil(d / s + lost time); M unbounded and T the lost
+	* time if s is unset. The default.
+	*/
+	class CopLinearDischarge : public CopDischargeProfile
+	{
+	public:
+		COP97A_API int getM(int phi, int xj, float satRate, float lostTime);
+		COP97A_API int getT(int d, int phi, float satRate, float lostTime);
+	};
+
+	/*
+	* Nothing clears during the startup lost time, then u * s per step, with
+	* u the utilisation of the lanes of the phase (1 = all lanes saturated)
+	*/
+	class CopStartupDischarge : public CopDischargeProfile
+	{
+	public:
+		COP97A_API CopStartupDischarge(float laneUtilization = 1.0f);
+		COP97A_API int getM(int phi, int xj, float satRate, float lostTime);
+		COP97A_API int getT(int d, int phi, float satRate, float lostTime);
+	private:
+		float laneUtilization;
+	};
+
+	/*
+	* COP solver for a junction of NPhases phases served in a fixed rotation,
+	* minimising Objective. Both are template arguments so that the phase loop
+	* has a constant trip count and the objective costs no branch; the DLL
+	* exports 2, 3 and 4 phases for every objective.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class Cop
 	{
 	public: 
-		//Cop97A();
-		 COP97A_API Cop97A(char*, int);	//load from file
-		 COP97A_API Cop97A(std::vector<int>, int, int);	//load from vector
-		 COP97A_API Cop97A(char*, int, int, int); //load from string
-		 COP97A_API Cop97A(char*, int, int); //load from file with Horizon
-		 COP97A_API Cop97A::Cop97A(std::vector<std::vector<int> >, int iphase, int horizon); // load from multiarray
-		 COP97A_API Cop97A::Cop97A(int iphase, int horizon);
-		 COP97A_API std::vector<int> getFeasibleGreens(int, int);
-		 COP97A_API int getInitialPhase();
-		 COP97A_API  int getRed();
-		 COP97A_API int getQ(int, int, int);
-		 COP97A_API int getArrivals(int, int, int);
-		 COP97A_API int getB(int, int, int);
-		 COP97A_API int getM(int, int); 
-		 COP97A_API int getT(int, int); 
-		 COP97A_API std::vector<int> getOptimalControl(); 
-		 COP97A_API float getSaturationFlow(int); 
-		 COP97A_API void setSaturationFlow(int phi, float satFlow);
-		 COP97A_API void setStartupLostTime(float time);
-		 COP97A_API void setInitialPhase(int p);
-		 COP97A_API void setMinGreenTime(int mingreen);
-		 COP97A_API void setMaxGreenTime(int maxgreen);
-		 COP97A_API void setRedTime(int redd);
-		 COP97A_API void setLanePhases(int phi, int lanes);
-		 COP97A_API void setHorizon(int h);
-		 COP97A_API void setMaxPhCompute(int mp);
-		 COP97A_API void setArrivals(std::vector<std::vector<int> > arrivals);
-		 COP97A_API int getArrivalEarliest(int, int, int, int); //NEW
-
-		 COP97A_API void resizeArrivals();
-		 COP97A_API void initMatrices(int);
-		 COP97A_API void printVector(std::vector<int> );
-		 COP97A_API void printMatrix(std::vector<std::vector<int> > );
-		 COP97A_API std::vector<int> printSequence(int[], int);
-		 COP97A_API void printArrivals();
-
-		 COP97A_API std::vector<int> RunCOP();
-		 COP97A_API bool loadFromFile(char*);
-		 COP97A_API bool loadFromSeq(char*, unsigned int, int);
-		 COP97A_API bool loadFromVector(std::vector<int>, int);
-		 COP97A_API void initParameters();
-
-		 COP97A_API void setOutput(bool);
+		//Cop();
+		Cop(char*, int);	//load from file
+		Cop(const std::vector<int>&, int, int);	//load from vector
+		Cop(char*, int, int, int); //load from string
+		Cop(char*, int, int); //load from file with Horizon
+		Cop(const std::vector<std::vector<int> >&, int iphase, int horizon); // load from multiarray
+		Cop(const int* data, unsigned int slots, int iphase, int horizon); // view of [slot * NPhases + phase], see setArrivals
+		Cop(int iphase, int horizon);
+		std::vector<int> getFeasibleGreens(int, int);
+		int getFeasibleGreens(int, int, int[]);	//into buffer, returns size
+		int getMaxCandidates();
+		int getInitialPhase();
+		int getRed();
+		int getQ(int, int, int);
+		int getArrivals(int, int, int);
+		int getB(int, int, int);
+		int getM(int, int);	//from the discharge tables once built
+		int getT(int, int);
+		std::vector<int> getOptimalControl(); 
+		int getOptimalControl(int out[], int capacity);	//into buffer, returns the sequence length
+		float getSaturationFlow(int); 
+		void setSaturationFlow(int phi, float satFlow);
+		void setStartupLostTime(float time);
+		void setInitialPhase(int p);
+		void setMinGreenTime(int mingreen);
+		void setMaxGreenTime(int maxgreen);
+		void setRedTime(int redd);
+		void setLanePhases(int phi, int lanes);
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//NULL = CopLinearDischarge (default)
+		void setHorizon(int h);	//a setArrivals view is dropped, the slots start empty
+		void setMaxPhCompute(int mp);
+		void configure(const CopJunction& junction);	//every parameter but the horizon
+		void setArrivals(const std::vector<std::vector<int> >& arrivals);	//copied
+		void setArrivals(const int* data, unsigned int slots, unsigned int slotStride = NPhases, unsigned int phaseStride = 1);	//not copied, read while solving
+		int getArrivalEarliest(int, int, int, int); //NEW
+
+		void resizeArrivals();
+		void buildArrivalIndex(unsigned int from = 0);
+		void initMatrices(int);
+		bool reserveWorkspace();	//true if the tables were reallocated
+		void printVector(std::vector<int> );
+		void printMatrix(std::vector<std::vector<int> > );
+		std::vector<int> printSequence(int[], int);
+		void printArrivals();
+
+		std::vector<int> RunCOP();
+		int solve();	//RunCOP without returning a copy, gives sequence length
+		int solve(std::chrono::steady_clock::time_point deadline);	//anytime: stops adding stages at the deadline
+		// reentrant: arrivals, read in place as by setArrivals(data, slots), solved with this configuration
+		// in context, which holds the tables and the result. This Cop is only read, so threads may share it,
+		// each with a context of its own, while nobody sets it. No trace
+		int solve(const int* arrivals, unsigned int slots, CopSolveContext<NPhases, Objective>& context,
+			std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) const;
+		CopSolveStats getSolveStats();
+		const CopResult& getResult();	//valid until the next solve
+		int solveAll();	//every objective in one sweep, gives the Objective sequence length
+		const CopResult& getResult(CopObjective objective);	//from the last solveAll
+		bool loadFromFile(char*);
+		bool loadFromSeq(char*, unsigned int, int);
+		bool loadFromVector(const std::vector<int>&, int);
+		void initParameters();
+
+		void setOutput(bool);	//trace to cout
+		void setTrace(std::ostream* sink);	//NULL = no trace (default), nothing is formatted then
+		void setThreads(int threads);	//1 = serial sweep (default)
+		int getThreads();
+		void setWarmStart(bool, float minReuse = 0.25f);	//reuse states before the first changed slot; offline only, see CopWarmStats
+		CopWarmStats getWarmStartStats();
+		void setVectorized(bool);	//SIMD candidate kernel (default), false = scalar
+		void setPruning(bool);	//skip greens whose lower bound cannot beat the best so far, solve only
+		void setLongHorizon(bool);	//rolling value and queue rows, narrow decisions; no warm start or table trace
+		// solve evaluates only the (j, sj) that v_j(T) and its recovery read, top-down from T, on the
+		// solving thread. Same result; off with a band, long horizon or trace, no warm start after it
+		void setLazy(bool);
+		size_t getWorkspaceBytes();
+		void setResultCache(size_t maxBytes);	//LRU of solve results by inputs, 0 = off (default)
+		void setResultCache(std::shared_ptr<CopResultCache> cache);	//shared between solvers, NULL = off
+		std::shared_ptr<CopResultCache> getResultCache();	//hit and miss counts
+		const CopProfile& getProfile();	//counters of the last solve or solveAll, see COP_PROFILING
+		// solve evaluates only states low[j - 1] <= sj <= high[j - 1] of stage j, the last entry reaching T,
+		// and every state of later stages; others are unreachable (v >= 2^30). Banded solves skip the
+		// result cache and warm start. Empty = every state (default)
+		void setStateBand(const std::vector<int>& low, const std::vector<int>& high);
+
+		static constexpr int unreachable = 1 << 30;	// value of states outside the band
+
+		static constexpr unsigned int phaseCount = NPhases;
+
+		// phase rotation A, B, C, ... wrapping at NPhases
+		static constexpr int nextPhase(int p) { return p == (int)NPhases - 1 ? 0 : p + 1; }
+		static constexpr int previousPhase(int p) { return p == 0 ? (int)NPhases - 1 : p - 1; }
 
 	private:
 
-		enum PIEnum {
-			QUEUES, STOPS, DELAY
-		};
-		int PI;
 		int red;
 		int mingreen;
 		int maxgreen;
@@ -84,19 +339,183 @@ namespace COP97A {
 		int idxCurrentPh; //= initialPhase; // set initial phase to C (2)
 		//float satHeadway; // avg headway between vehicles during saturated flow
 		//float satFlowRate; // = 0.0; No.Lanes / satHeadway
-		float satFlows[3]; //per phase
-		int lanePhases[3]; //per phase
-		bool output;
-		char phaseSeq[3]; // A, B, C
-		std::vector<int> phases; // A = 0, B = 1, C = 2
-		std::vector<int> optControlSequence; // A = 0, B = 1, C = 2
-		std::vector< std::vector<int> > arrivalData; //---------------------> state rep
-		std::vector< std::vector<int> > v; //v_j(s_j);
-		std::vector< std::vector<int> > x_star; // optimal solutions x*_j(s_j)
-		std::vector<std::vector<std::vector<int> > > Q; // permanent queue lengths Q_{phi, j}(s_j)
-		std::vector<std::vector<std::vector<int> > > L; // temporary queue lengths Q_{phi, j}(s_j, x_j)
-		std::vector<std::vector<std::vector<int> > > S; // temporary stopped  L_{sigma, j}(s_j, x_j)
+		float satFlows[NPhases]; //per phase
+		int lanePhases[NPhases]; //per phase
+		std::ostream* trace;
+		char phaseSeq[NPhases]; // A, B, C
+		CopResult result; // sequence A = 0, B = 1, C = 2
+		std::vector<int> arrivalStore; // owned arrivals [slot * NPhases + phase]
+		const int* arrivalView; // caller memory given to setArrivals, NULL = arrivalStore
+		unsigned int arrivalSlots;
+		unsigned int slotStride, phaseStride;
+		inline int arrival(unsigned int k, unsigned int phi) { return (arrivalView != NULL ? arrivalView : arrivalStore.data())[k * slotStride + phi * phaseStride]; } //---------------------> state rep
+		std::vector< std::vector<int> > cumArrivals; // per phase, vehicles arrived in [0,k)
+		std::vector< std::vector<int> > cumRequests; // per phase, steps with arrivals in [0,k)
+		std::vector< std::vector<int> > cumRequestTimes; // per phase, sum of those step indices
+		std::shared_ptr<CopDischargeProfile> dischargeProfile; // never NULL
+		std::vector< std::vector<int> > dischargeVehicles; // per phase, getM by green
+		std::vector< std::vector<int> > dischargeTimes; // per phase, getT by vehicles, up to the most that can queue
+		int dischargeMost[NPhases]; // most of dischargeVehicles
+		int dischargeTimeMin[NPhases]; // least of dischargeTimes, for the pruning bound
+		bool dischargeStale; // parameters changed since the tables were built
+		CopWorkspace ws; // v, x*, Q, L, S, X and the sequence, see CopWorkspace
+		int threads;
+		std::shared_ptr<CopThreadPool> pool; // created on first parallel solve
+		CopCandidateKernel kernel; // NULL for the scalar candidate loop
+		CopMultiCandidateKernel multiKernel;
+		CopWorkspace objectiveWs[COP_OBJECTIVE_COUNT]; // solveAll tables by CopObjective, empty until used
+		CopResult objectiveResults[COP_OBJECTIVE_COUNT];
+		bool objectiveRunning[COP_OBJECTIVE_COUNT]; // not yet stopped in solveAll
+
+		struct PruneCount
+		{
+			unsigned int candidates, pruned;
+			char pad[56];	// one cache line per worker
+		};
+
+		bool pruning;
+		bool longHorizon;
+		bool lazy;
+		std::vector<unsigned char> lazyMarks; // [j * (T + 1) + sj], see evaluateDemanded
+		std::vector<std::vector<unsigned int> > lazyPending; // per stage, states to evaluate
+		unsigned int minLevels;
+		std::vector<int> minTables; // range minima of v_{j-1} and of each Q row of stage j - 1
+		std::vector<PruneCount> pruneCounts; // per worker
+
+		std::shared_ptr<CopResultCache> cache;
+		std::vector<int> cacheKey; // every input of the solve, see buildCacheKey
+		std::vector<int> bandLow, bandHigh; // per stage, see setStateBand
+
+		struct ProfileCount
+		{
+			unsigned long long calls[COP_CALL_COUNT];
+			unsigned long long candidates;
+			char pad[16];	// one cache line per worker
+		};
+
+		CopProfile profile;
+		std::vector<ProfileCount> profileCounts; // per worker
+		unsigned long long* profileOuter; // call counters of the solving thread before the solve
 
+		// parameters the stage tables were computed with
+		struct WarmKey
+		{
+			int phase, red, mingreen, maxgreen;
+			unsigned int T, M;
+			float lostTime;
+			float satRates[NPhases];
+		};
+
+		bool warmStart;
+		float warmMinReuse;			// full solve below this fraction of T unchanged
+		unsigned int firstChange;	// first arrival slot changed since the last solve
+		unsigned int warmStages;	// stages held in ws from the last solve
+		WarmKey warmKey;
+		CopWarmStats warmStats;
+
+		WarmKey getWarmKey();
+		bool sameWarmKey(const WarmKey&, const WarmKey&);
+		int getWarmBound(unsigned int j);
+
+		// sweep of the states sj of stage j, split across the pool
+		class StageSweep : public CopTask
+		{
+		public:
+			StageSweep(Cop* cop, unsigned int j, unsigned int first, bool all = false) : cop(cop), j(j), first(first), all(all) {}
+			void execute(unsigned int worker, unsigned int begin, unsigned int end);
+		private:
+			Cop* cop;
+			unsigned int j;
+			unsigned int first;	// first state sj to evaluate
+			bool all;			// every objective, for solveAll
+		};
+
+		int getQ(CopWorkspace& tables, int, int, int);
+		int evaluateState(unsigned int j, unsigned int sj, unsigned int worker);
+		unsigned int evaluateDemanded(unsigned int j, int startPhase);
+		int evaluateStates(unsigned int j, unsigned int sj, unsigned int worker);
+		template<CopObjective O>
+		int evaluateGreen(CopWorkspace& tables, unsigned int j, unsigned int sj, int xj, int index_xj, unsigned int worker);
+		template<CopObjective O>
+		void settleState(CopWorkspace& tables, unsigned int j, unsigned int sj, unsigned int worker, const int* X, int xSz, const CopCandidateResult* block);
+		void settlePruned(unsigned int j, unsigned int sj, unsigned int worker, const int* X, int xSz);
+		void storeState(CopWorkspace& tables, unsigned int j, unsigned int sj, unsigned int worker, int value, int xj, int index_xj);
+		void buildMinTables(unsigned int j);
+		int minValue(int siLow, int siHigh);
+		int lowerBound(unsigned int sj, int siLow, int siHigh, int fixedBound);
+		void fillCandidateInputs(CopWorkspace& tables, CopObjective objective, unsigned int j, unsigned int sj, int firstGreen, int count, CopCandidateInputs& in);
+		void initTables(CopWorkspace& tables, int init);
+		unsigned int firstChangedSlot(const int* data, unsigned int slots, unsigned int dataSlotStride, unsigned int dataPhaseStride);
+		void ownArrivals(unsigned int slots);
+		void buildCacheKey();
+		void buildDischargeTables();
+		unsigned int getDischargeTimesSize(unsigned int phi, unsigned int greens);
+		void recoverSequence(CopWorkspace& tables, int jsize, CopResult& out);
+		void configure(const Cop& config);
+		void printControl(int[], int);
+		void profileBegin();
+		void profileStage(unsigned int j, unsigned int states, std::chrono::steady_clock::time_point begun);
+		void profileEnd(std::chrono::steady_clock::time_point started, size_t allocated);
+
+	};
+
+	/*
+	* What the solves of one thread write: a Cop of its own whose tables,
+	* arrival sums, warm start and result carry over from solve to solve.
+	* It takes the parameters and options of the configuration it is solved
+	* with where they differ, see Cop::solve(arrivals, slots, context).
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopSolveContext
+	{
+	public:
+		CopSolveContext();
+		void setInitialPhase(int p);	//-1 = the configuration's (default)
+		const CopResult& getResult();	//valid until the next solve in this context
+		int getOptimalControl(int out[], int capacity);	//into buffer, returns the sequence length
+		CopWarmStats getWarmStartStats();
+		const CopProfile& getProfile();
+		size_t getWorkspaceBytes();
+
+	private:
+		friend class Cop<NPhases, Objective>;
+		Cop<NPhases, Objective> solver;
+		int phase;
+	};
+
+	// defined in COP97A.cpp
+	extern template class COP97A_API Cop<2, COP_QUEUES>;
+	extern template class COP97A_API Cop<2, COP_STOPS>;
+	extern template class COP97A_API Cop<2, COP_DELAY>;
+	extern template class COP97A_API Cop<3, COP_QUEUES>;
+	extern template class COP97A_API Cop<3, COP_STOPS>;
+	extern template class COP97A_API Cop<3, COP_DELAY>;
+	extern template class COP97A_API Cop<4, COP_QUEUES>;
+	extern template class COP97A_API Cop<4, COP_STOPS>;
+	extern template class COP97A_API Cop<4, COP_DELAY>;
+	extern template class COP97A_API CopSolveContext<2, COP_QUEUES>;
+	extern template class COP97A_API CopSolveContext<2, COP_STOPS>;
+	extern template class COP97A_API CopSolveContext<2, COP_DELAY>;
+	extern template class COP97A_API CopSolveContext<3, COP_QUEUES>;
+	extern template class COP97A_API CopSolveContext<3, COP_STOPS>;
+	extern template class COP97A_API CopSolveContext<3, COP_DELAY>;
+	extern template class COP97A_API CopSolveContext<4, COP_QUEUES>;
+	extern template class COP97A_API CopSolveContext<4, COP_STOPS>;
+	extern template class COP97A_API CopSolveContext<4, COP_DELAY>;
+
+	/*
+	* The original 3-phase junction (A, B, C) minimising delay
+	*/
+	class Cop97A : public Cop<3, COP_DELAY>
+	{
+	public: 
+		Cop97A(char* file, int iphase) : Cop<3, COP_DELAY>(file, iphase) {}	//load from file
+		Cop97A(const std::vector<int>& data, int nphases, int iphase) : Cop<3, COP_DELAY>(data, nphases, iphase) {}	//load from vector
+		Cop97A(char* data, int size, int nphases, int iphase) : Cop<3, COP_DELAY>(data, size, nphases, iphase) {} //load from string
+		Cop97A(char* file, int iphase, int horizon) : Cop<3, COP_DELAY>(file, iphase, horizon) {} //load from file with Horizon
+		Cop97A(const std::vector<std::vector<int> >& data, int iphase, int horizon) : Cop<3, COP_DELAY>(data, iphase, horizon) {} // load from multiarray
+		Cop97A(const int* data, unsigned int slots, int iphase, int horizon) : Cop<3, COP_DELAY>(data, slots, iphase, horizon) {} // view of [slot * 3 + phase]
+		Cop97A(int iphase, int horizon) : Cop<3, COP_DELAY>(iphase, horizon) {}
 	};
 }
 
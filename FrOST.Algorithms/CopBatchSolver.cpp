@@ -0,0 +1,250 @@
+// Many junctions solved on one pool
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "CopBatchSolver.h"
+#include "CopResultCache.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopBatchSolver<NPhases, Objective>::CopBatchSolver(unsigned int n, int nThreads)
+		: junctions(n), threads(nThreads < 1 ? 1 : nThreads), pool(nThreads < 1 ? 1 : nThreads), slotStride(0), sequenceStride(0)
+	{
+		for (unsigned int w = 0; w < pool.size(); w++)
+			solvers.push_back(Cop<NPhases, Objective>(0, 10));	// serial, the batch is split by junction
+		solverHorizon.assign(pool.size(), 10);
+
+		initialPhase.resize(n);
+		red.resize(n);
+		mingreen.resize(n);
+		maxgreen.resize(n);
+		lostTime.resize(n);
+		horizon.resize(n);
+		maxPhases.resize(n);
+		satFlows.resize(NPhases * n);
+		lanes.resize(NPhases * n);
+		for (unsigned int i = 0; i < n; i++)
+			setJunction(i, CopJunction());
+
+		sequenceLength.assign(n, 0);
+		values.assign(n, 0);
+		queues.assign(NPhases * n, 0);
+		stats.resize(n);
+		batchStats.junctions = n;
+		batchStats.seconds = batchStats.solvesPerSecond = 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int CopBatchSolver<NPhases, Objective>::size()
+	{
+		return junctions;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopBatchSolver<NPhases, Objective>::getThreads()
+	{
+		return threads;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::reserveSlots(unsigned int slots)
+	{
+		if (slots <= slotStride)
+			return;
+
+		// relayout the phase rows with the longer horizon, junctions keep their arrivals
+		vector<int> old(NPhases * junctions * slots, 0);
+		old.swap(arrivals);
+		for (unsigned int phi = 0; phi < NPhases; phi++)
+			for (unsigned int i = 0; i < junctions; i++)
+				for (unsigned int k = 0; k < slotStride; k++)
+					arrivals[(phi * junctions + i) * slots + k] = old[(phi * junctions + i) * slotStride + k];
+		slotStride = slots;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::setJunction(unsigned int i, const CopJunction& junction)
+	{
+		initialPhase[i] = junction.initialPhase;
+		red[i] = junction.red;
+		mingreen[i] = junction.mingreen;
+		maxgreen[i] = junction.maxgreen;
+		lostTime[i] = junction.lostTime;
+		horizon[i] = junction.horizon;
+		maxPhases[i] = junction.maxPhases;
+		for (unsigned int phi = 0; phi < NPhases; phi++) {
+			satFlows[phi * junctions + i] = junction.satFlows[phi];
+			lanes[phi * junctions + i] = junction.lanes[phi];
+		}
+		reserveSlots(junction.horizon);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopJunction CopBatchSolver<NPhases, Objective>::getJunction(unsigned int i)
+	{
+		CopJunction junction;
+		junction.initialPhase = initialPhase[i];
+		junction.red = red[i];
+		junction.mingreen = mingreen[i];
+		junction.maxgreen = maxgreen[i];
+		junction.lostTime = lostTime[i];
+		junction.horizon = horizon[i];
+		junction.maxPhases = maxPhases[i];
+		for (unsigned int phi = 0; phi < NPhases; phi++) {
+			junction.satFlows[phi] = satFlows[phi * junctions + i];
+			junction.lanes[phi] = lanes[phi * junctions + i];
+		}
+		return junction;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::setArrivals(unsigned int i, const vector<vector<int> >& data)
+	{
+		// slots past the end of data, or past the horizon, are taken as empty
+		for (unsigned int k = 0; k < horizon[i]; k++)
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				arrival(i, phi, k) = k < data.size() && phi < data[k].size() ? data[k][phi] : 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::setVectorized(bool option)
+	{
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			solvers[w].setVectorized(option);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::setPruning(bool option)
+	{
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			solvers[w].setPruning(option);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::setDischargeProfile(shared_ptr<CopDischargeProfile> profile)
+	{
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			solvers[w].setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::setResultCache(size_t maxBytes)
+	{
+		// junctions with the same inputs, e.g. empty horizons, hit each other
+		shared_ptr<CopResultCache> cache;
+		if (maxBytes > 0)
+			cache = make_shared<CopResultCache>(maxBytes);
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			solvers[w].setResultCache(cache);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	shared_ptr<CopResultCache> CopBatchSolver<NPhases, Objective>::getResultCache()
+	{
+		return solvers[0].getResultCache();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::JunctionSweep::execute(unsigned int worker, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int n = begin; n < end; n++)
+			batch->solveJunction(worker, batch->order[n]);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopBatchSolver<NPhases, Objective>::solveJunction(unsigned int worker, unsigned int i)
+	{
+		Cop<NPhases, Objective>& cop = solvers[worker];
+
+		cop.configure(getJunction(i));
+
+		if (solverHorizon[worker] != horizon[i]) {
+			cop.setHorizon(horizon[i]);
+			solverHorizon[worker] = horizon[i];
+		}
+		// in place, phases one row of junctions apart
+		cop.setArrivals(&arrival(i, 0, 0), horizon[i], 1, junctions * slotStride);
+
+		cop.solve();
+
+		const CopResult& result = cop.getResult();
+		unsigned int length = min((unsigned int)result.sequence.size(), sequenceStride);
+		copy(result.sequence.begin(), result.sequence.begin() + length, sequences.begin() + i * sequenceStride);
+		sequenceLength[i] = length;
+		values[i] = result.value;
+		for (unsigned int phi = 0; phi < NPhases && phi < result.queues.size(); phi++)
+			queues[phi * junctions + i] = result.queues[phi];
+		stats[i] = result.stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopBatchStats CopBatchSolver<NPhases, Objective>::solve()
+	{
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		if (junctions == 0)
+			return batchStats;
+
+		sequenceStride = *max_element(maxPhases.begin(), maxPhases.end());
+		if (sequences.size() < junctions * sequenceStride)
+			sequences.resize(junctions * sequenceStride);
+
+		// longest horizons first, so that no worker is left with a big one at the end
+		order.resize(junctions);
+		for (unsigned int i = 0; i < junctions; i++)
+			order[i] = i;
+		stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return horizon[a] > horizon[b]; });
+
+		JunctionSweep sweep(this);
+		pool.run(sweep, junctions, 1);
+
+		batchStats.junctions = junctions;
+		batchStats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		batchStats.solvesPerSecond = batchStats.seconds > 0 ? junctions / batchStats.seconds : 0;
+		return batchStats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopBatchStats CopBatchSolver<NPhases, Objective>::getBatchStats()
+	{
+		return batchStats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> CopBatchSolver<NPhases, Objective>::getOptimalControl(unsigned int i)
+	{
+		vector<int>::const_iterator first = sequences.begin() + i * sequenceStride;
+		return vector<int>(first, first + sequenceLength[i]);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopBatchSolver<NPhases, Objective>::getValue(unsigned int i)
+	{
+		return values[i];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopBatchSolver<NPhases, Objective>::getQueue(unsigned int i, int phi)
+	{
+		return queues[phi * junctions + i];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopSolveStats CopBatchSolver<NPhases, Objective>::getSolveStats(unsigned int i)
+	{
+		return stats[i];
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopBatchSolver<2, COP_QUEUES>;
+	template class CopBatchSolver<2, COP_STOPS>;
+	template class CopBatchSolver<2, COP_DELAY>;
+	template class CopBatchSolver<3, COP_QUEUES>;
+	template class CopBatchSolver<3, COP_STOPS>;
+	template class CopBatchSolver<3, COP_DELAY>;
+	template class CopBatchSolver<4, COP_QUEUES>;
+	template class CopBatchSolver<4, COP_STOPS>;
+	template class CopBatchSolver<4, COP_DELAY>;
+}
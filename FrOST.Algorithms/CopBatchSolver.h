@@ -0,0 +1,110 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPBATCHSOLVER_API __declspec(dllexport)
+#else
+#define COPBATCHSOLVER_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPBATCHSOLVER
+#define FROST_ALGORITHMS_COPBATCHSOLVER
+
+#include "COP97A.h"
+#include <vector>
+
+namespace COP97A {
+
+	/*
+	* How the last batch solve went
+	*/
+	struct CopBatchStats
+	{
+		unsigned int junctions;
+		double seconds;			// wall time of the whole batch
+		double solvesPerSecond;
+	};
+
+	/*
+	* Solves N independent junctions, e.g. the signals of a corridor, on one
+	* shared pool. Every worker owns a single Cop and solves whole junctions
+	* with it one after another, so its tables are allocated once and stay in
+	* cache. Inputs and results are kept one array per field across the
+	* junctions: arrivals(i, phi, k) of all junctions sit in one row per phase,
+	* and each Cop reads its junction there in place.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopBatchSolver
+	{
+	public:
+		CopBatchSolver(unsigned int junctions, int threads = 1);
+		unsigned int size();
+		int getThreads();
+		void setJunction(unsigned int i, const CopJunction& junction);
+		CopJunction getJunction(unsigned int i);
+		void setArrivals(unsigned int i, const std::vector<std::vector<int> >& arrivals);	//[slot][phase], as Cop::setArrivals
+		void setVectorized(bool);
+		void setPruning(bool);
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//every junction, NULL = linear
+		void setResultCache(size_t maxBytes);	//one cache for every worker, 0 = off
+		std::shared_ptr<CopResultCache> getResultCache();
+
+		CopBatchStats solve();	//every junction, blocks until done
+		CopBatchStats getBatchStats();
+		std::vector<int> getOptimalControl(unsigned int i);
+		int getValue(unsigned int i);
+		int getQueue(unsigned int i, int phi);	//permanent queue at the end of the horizon
+		CopSolveStats getSolveStats(unsigned int i);
+
+	private:
+		// junctions [begin, end) of the solve order
+		class JunctionSweep : public CopTask
+		{
+		public:
+			JunctionSweep(CopBatchSolver* batch) : batch(batch) {}
+			void execute(unsigned int worker, unsigned int begin, unsigned int end);
+		private:
+			CopBatchSolver* batch;
+		};
+
+		void solveJunction(unsigned int worker, unsigned int i);
+		void reserveSlots(unsigned int slots);
+		inline int& arrival(unsigned int i, unsigned int phi, unsigned int k) { return arrivals[(phi * junctions + i) * slotStride + k]; }
+
+		unsigned int junctions;
+		int threads;
+		CopThreadPool pool;
+		std::vector<Cop<NPhases, Objective> > solvers;	// per worker
+		std::vector<unsigned int> solverHorizon;	// per worker, T of its Cop
+		std::vector<unsigned int> order;	// longest horizons first
+
+		// parameters, one entry per junction
+		std::vector<int> initialPhase, red, mingreen, maxgreen;
+		std::vector<float> lostTime;
+		std::vector<unsigned int> horizon, maxPhases;
+		std::vector<float> satFlows;	// [phi * junctions + i]
+		std::vector<int> lanes;
+
+		unsigned int slotStride;		// longest horizon
+		std::vector<int> arrivals;		// see arrival()
+
+		// results, one entry per junction
+		unsigned int sequenceStride;	// largest M
+		std::vector<int> sequences;		// [i * sequenceStride + n]
+		std::vector<unsigned int> sequenceLength;
+		std::vector<int> values;
+		std::vector<int> queues;		// [phi * junctions + i]
+		std::vector<CopSolveStats> stats;
+		CopBatchStats batchStats;
+	};
+
+	// defined in CopBatchSolver.cpp
+	extern template class COPBATCHSOLVER_API CopBatchSolver<2, COP_QUEUES>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<2, COP_STOPS>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<2, COP_DELAY>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<3, COP_QUEUES>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<3, COP_STOPS>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<3, COP_DELAY>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<4, COP_QUEUES>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<4, COP_STOPS>;
+	extern template class COPBATCHSOLVER_API CopBatchSolver<4, COP_DELAY>;
+}
+
+#endif
@@ -0,0 +1,340 @@
+// Differential check of Cop against the exhaustive reference
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include "CopDifferential.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopDifferential<NPhases, Objective>::CopDifferential()
+	{
+		modes.push_back(CopDifferentialMode("vector", true, false, 1, false, false));
+		modes.push_back(CopDifferentialMode("prune", false, true, 1, false, false));
+		modes.push_back(CopDifferentialMode("threads", false, false, 2, false, false));
+		modes.push_back(CopDifferentialMode("long", false, false, 1, true, false));
+		modes.push_back(CopDifferentialMode("warm", false, false, 1, false, true));
+		modes.push_back(CopDifferentialMode("lazy", false, false, 1, false, false, true));
+		modes.push_back(CopDifferentialMode("all", true, true, 2, true, false));
+
+		stats.cases = stats.inconsistent = stats.indexQuirks = 0;
+		stats.aboveOptimum = stats.belowOptimum = stats.incomplete = 0;
+		stats.meanGap = stats.referenceRatio = stats.seconds = 0;
+		stats.originalCases = stats.originalDifferences = 0;
+		stats.originalSpeedup = 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopDifferential<NPhases, Objective>::setOptions(const CopDifferentialOptions& option)
+	{
+		options = option;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopDifferentialOptions CopDifferential<NPhases, Objective>::getOptions()
+	{
+		return options;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopDifferential<NPhases, Objective>::setModes(const vector<CopDifferentialMode>& option)
+	{
+		modes = option;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<CopDifferentialMode> CopDifferential<NPhases, Objective>::getModes()
+	{
+		return modes;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopDifferential<NPhases, Objective>::setDischargeProfile(shared_ptr<CopDischargeProfile> option)
+	{
+		profile = option;
+		reference.setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopDifferential<NPhases, Objective>::draw(unsigned int k, CopJunction& junction, vector<vector<int> >& arrivals)
+	{
+		// mt19937 draws are the same on every platform, and so the cases
+		mt19937 random(options.seed + k);
+		const unsigned int horizons = options.maxHorizon > options.minHorizon ? options.maxHorizon - options.minHorizon + 1 : 1;
+
+		junction = CopJunction();
+		junction.horizon = options.minHorizon + random() % horizons;
+		junction.initialPhase = random() % NPhases;
+		junction.red = 1 + random() % max(1, options.maxRed);
+		junction.mingreen = 1 + random() % max(1, options.maxMinGreen);
+		junction.maxgreen = junction.mingreen + 1 + random() % max(1, options.maxGreenSpan);
+		for (unsigned int phi = 0; phi < NPhases; phi++) {
+			float u = uniformDraw(random);
+			junction.satFlows[phi] = u < options.satFlowChance ? 0.5f + 0.25f * (random() % 4) : -1.0f;
+		}
+
+		arrivals.assign(junction.horizon, vector<int>(NPhases, 0));
+		for (unsigned int s = 0; s < junction.horizon; s++) {
+			for (unsigned int phi = 0; phi < NPhases; phi++) {
+				float u = uniformDraw(random);
+				if (u < options.density)
+					arrivals[s][phi] = 1 + random() % max(1, options.maxArrivals);
+			}
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	double CopDifferential<NPhases, Objective>::timeSolve(Cop<NPhases, Objective>& cop, const CopDifferentialMode& mode, const CopJunction& junction,
+		const vector<vector<int> >& arrivals)
+	{
+		cop.configure(junction);
+		cop.setDischargeProfile(profile);
+		cop.setVectorized(mode.vectorized);
+		cop.setPruning(mode.pruning);
+		cop.setThreads(mode.threads);
+		cop.setLongHorizon(mode.longHorizon);
+		cop.setWarmStart(mode.warmStart);
+		cop.setLazy(mode.lazy);
+
+		// warm: the horizon before has one more vehicle in every slot past the
+		// unchanged share, as new detections would, so only the states before reuse
+		vector<vector<int> > before;
+		if (mode.warmStart) {
+			before = arrivals;
+			for (unsigned int s = (unsigned int)(options.warmUnchanged * arrivals.size()); s < before.size(); s++)
+				before[s][s % NPhases]++;
+		}
+
+		// solve advances the phase, every repeat starts from the same one
+		double fastest = 0;
+		for (unsigned int r = 0; r < max(1u, options.repeats); r++) {
+			if (mode.warmStart) {
+				cop.setArrivals(before);
+				cop.setInitialPhase(junction.initialPhase);
+				cop.solve();
+			}
+			if (r == 0 || mode.warmStart)
+				cop.setArrivals(arrivals);
+			cop.setInitialPhase(junction.initialPhase);
+			const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+			cop.solve();
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+			if (r == 0 || seconds < fastest)
+				fastest = seconds;
+		}
+		return fastest;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	double CopDifferential<NPhases, Objective>::timeOriginal(const CopJunction& junction, const vector<vector<int> >& arrivals,
+		vector<int>& sequence)
+	{
+		CopOriginal original(junction.initialPhase, junction.horizon);
+		original.setRedTime(junction.red);
+		original.setMinGreenTime(junction.mingreen);
+		original.setMaxGreenTime(junction.maxgreen);
+		original.setStartupLostTime(junction.lostTime);
+		original.setMaxPhCompute(junction.maxPhases);
+		for (unsigned int phi = 0; phi < NPhases; phi++) {
+			original.setSaturationFlow(phi, junction.satFlows[phi]);
+			original.setLanePhases(phi, junction.lanes[phi]);
+		}
+		original.setArrivals(arrivals);
+
+		// RunCOP prints its sequence, a stream without a buffer drops it
+		streambuf* shown = cout.rdbuf(NULL);
+		double fastest = 0;
+		for (unsigned int r = 0; r < max(1u, options.repeats); r++) {
+			original.setInitialPhase(junction.initialPhase);
+			const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+			original.RunCOP();
+			double seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+			if (r == 0 || seconds < fastest)
+				fastest = seconds;
+		}
+		cout.rdbuf(shown);
+		cout.clear();
+		sequence = original.getOptimalControl();
+		return fastest;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopDifferentialStats CopDifferential<NPhases, Objective>::run()
+	{
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		const CopDifferentialMode baseline("baseline", false, false, 1, false, false);
+		const unsigned int nModes = (unsigned int)modes.size();
+
+		cases.assign(options.cases, CopDifferentialCase());
+		records.assign(options.cases * nModes, CopDifferentialRecord());
+		stats.cases = options.cases;
+		stats.inconsistent = stats.indexQuirks = 0;
+		stats.aboveOptimum = stats.belowOptimum = stats.incomplete = 0;
+		stats.differences.assign(nModes, 0);
+		stats.speedups.assign(nModes, 0);
+		stats.originalCases = stats.originalDifferences = 0;
+		stats.originalSpeedups.assign(nModes, 0);
+		double gaps = 0, logRatio = 0, logOriginal = 0;
+		unsigned int gapCases = 0, timedCases = 0, originalTimed = 0;
+		vector<double> logSpeedups(nModes, 0), logOriginals(nModes, 0);
+		vector<int> originalSequence;
+
+		reference.setMaxPaths(options.maxPaths);
+		vector<vector<int> > arrivals;
+
+		for (unsigned int k = 0; k < options.cases; k++) {
+			CopDifferentialCase& c = cases[k];
+			draw(k, c.junction, arrivals);
+
+			// a solver per case and mode, as a controller sizes its own
+			Cop<NPhases, Objective> base(c.junction.initialPhase, c.junction.horizon);
+			c.seconds = timeSolve(base, baseline, c.junction, arrivals);
+			const CopResult& result = base.getResult();
+			c.stages = (unsigned int)result.sequence.size();
+			c.value = result.value;
+
+			// what CopOriginal handles; it sizes its stage list by T
+			c.original = NPhases == 3 && Objective == COP_DELAY && !profile && c.junction.horizon >= c.junction.maxPhases;
+			c.originalIdentical = false;
+			c.originalSeconds = 0;
+			if (c.original) {
+				c.originalSeconds = timeOriginal(c.junction, arrivals, originalSequence);
+				c.originalIdentical = originalSequence == result.sequence;
+				stats.originalCases++;
+				if (!c.originalIdentical)
+					stats.originalDifferences++;
+			}
+			const bool originalTiming = c.original && c.originalSeconds > 0 && c.seconds > 0;
+			if (originalTiming) {
+				logOriginal += log(c.originalSeconds / c.seconds);
+				originalTimed++;
+			}
+
+			reference.setJunction(c.junction);
+			reference.setArrivals(arrivals);
+			c.evaluated = reference.evaluate(result.sequence);
+			c.clamped = reference.isClamped();
+			c.consistent = c.value == c.evaluated;
+
+			chrono::steady_clock::time_point referenceStarted = chrono::steady_clock::now();
+			reference.solve(c.stages);
+			c.referenceSeconds = chrono::duration<double>(chrono::steady_clock::now() - referenceStarted).count();
+			c.optimum = reference.getValue();
+			c.paths = reference.getPaths();
+			c.complete = reference.isComplete();
+
+			if (!c.consistent && c.junction.red == 1 && !c.clamped)
+				stats.inconsistent++;
+			else if (!c.consistent)
+				stats.indexQuirks++;
+			if (!c.complete)
+				stats.incomplete++;
+			else {
+				if (c.evaluated > c.optimum)
+					stats.aboveOptimum++;
+				if (c.value < c.optimum)
+					stats.belowOptimum++;
+				if (c.optimum > 0) {
+					gaps += (double)(c.evaluated - c.optimum) / c.optimum;
+					gapCases++;
+				}
+			}
+			const bool timed = c.seconds > 0 && c.referenceSeconds > 0;
+			if (timed) {
+				logRatio += log(c.referenceSeconds / c.seconds);
+				timedCases++;
+			}
+
+			for (unsigned int m = 0; m < nModes; m++) {
+				CopDifferentialRecord& record = records[k * nModes + m];
+				Cop<NPhases, Objective> cop(c.junction.initialPhase, c.junction.horizon);
+				record.testCase = k;
+				record.mode = m;
+				record.seconds = timeSolve(cop, modes[m], c.junction, arrivals);
+				record.value = cop.getResult().value;
+				record.identical = record.value == c.value && cop.getResult().sequence == result.sequence;
+				record.speedup = record.seconds > 0 ? c.seconds / record.seconds : 0;
+				record.originalSpeedup = c.original && record.seconds > 0 ? c.originalSeconds / record.seconds : 0;
+				if (!record.identical)
+					stats.differences[m]++;
+				if (timed && record.seconds > 0)
+					logSpeedups[m] += log(record.speedup);
+				if (originalTiming && record.seconds > 0)
+					logOriginals[m] += log(record.originalSpeedup);
+			}
+		}
+
+		stats.meanGap = gapCases > 0 ? gaps / gapCases : 0;
+		stats.referenceRatio = timedCases > 0 ? exp(logRatio / timedCases) : 0;
+		stats.originalSpeedup = originalTimed > 0 ? exp(logOriginal / originalTimed) : 0;
+		for (unsigned int m = 0; m < nModes; m++) {
+			stats.speedups[m] = timedCases > 0 ? exp(logSpeedups[m] / timedCases) : 0;
+			stats.originalSpeedups[m] = originalTimed > 0 ? exp(logOriginals[m] / originalTimed) : 0;
+		}
+		stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopDifferentialStats CopDifferential<NPhases, Objective>::getStats()
+	{
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopDifferentialCase& CopDifferential<NPhases, Objective>::getCase(unsigned int k)
+	{
+		return cases[k];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopDifferentialRecord& CopDifferential<NPhases, Objective>::getRecord(unsigned int k, unsigned int mode)
+	{
+		return records[k * modes.size() + mode];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopDifferential<NPhases, Objective>::writeCsv(ostream& out)
+	{
+		out << "case,horizon,red,mingreen,maxgreen,stages,optimum,evaluated,clamped,complete,paths,reference_seconds,"
+			"mode,value,identical,seconds,speedup,original_speedup\n";
+
+		const unsigned int nModes = (unsigned int)modes.size();
+		for (unsigned int k = 0; k < cases.size(); k++) {
+			const CopDifferentialCase& c = cases[k];
+			const double originalSpeedup = c.original && c.seconds > 0 ? c.originalSeconds / c.seconds : 0;
+			for (int m = -1; m <= (int)nModes; m++) {
+				if (m == -1 && !c.original)
+					continue;
+				out << k << ',' << c.junction.horizon << ',' << c.junction.red << ',' << c.junction.mingreen << ','
+					<< c.junction.maxgreen << ',' << c.stages << ',' << c.optimum << ',' << c.evaluated << ','
+					<< c.clamped << ',' << c.complete << ',' << c.paths << ',' << c.referenceSeconds << ',';
+				if (m == -1)	// no value of its own, RunCOP gives the sequence only
+					out << "original,," << c.originalIdentical << ',' << c.originalSeconds << ','
+						<< (c.originalSeconds > 0 ? c.seconds / c.originalSeconds : 0) << ",1\n";
+				else if (m == 0)
+					out << "baseline," << c.value << ",1," << c.seconds << ",1," << originalSpeedup << '\n';
+				else {
+					const CopDifferentialRecord& record = records[k * nModes + m - 1];
+					out << modes[m - 1].name << ',' << record.value << ',' << record.identical << ','
+						<< record.seconds << ',' << record.speedup << ',' << record.originalSpeedup << '\n';
+				}
+			}
+		}
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopDifferential<2, COP_QUEUES>;
+	template class CopDifferential<2, COP_STOPS>;
+	template class CopDifferential<2, COP_DELAY>;
+	template class CopDifferential<3, COP_QUEUES>;
+	template class CopDifferential<3, COP_STOPS>;
+	template class CopDifferential<3, COP_DELAY>;
+	template class CopDifferential<4, COP_QUEUES>;
+	template class CopDifferential<4, COP_STOPS>;
+	template class CopDifferential<4, COP_DELAY>;
+}
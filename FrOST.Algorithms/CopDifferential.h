@@ -0,0 +1,180 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPDIFFERENTIAL_API __declspec(dllexport)
+#else
+#define COPDIFFERENTIAL_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPDIFFERENTIAL
+#define FROST_ALGORITHMS_COPDIFFERENTIAL
+
+#include "COP97A.h"
+#include "CopReference.h"
+#include "CopOriginal.h"
+#include <vector>
+#include <string>
+#include <iostream>
+
+namespace COP97A {
+
+	/*
+	* How the random cases are drawn, each parameter uniformly in its range
+	*/
+	struct CopDifferentialOptions
+	{
+		unsigned int cases;
+		unsigned int seed;				// case k draws from seed + k
+		unsigned int minHorizon, maxHorizon;
+		int maxRed;						// red in 1 .. maxRed
+		int maxMinGreen;				// mingreen in 1 .. maxMinGreen
+		int maxGreenSpan;				// maxgreen in mingreen + 1 .. mingreen + maxGreenSpan
+		float satFlowChance;			// per phase, the saturation flow is set (0.5 .. 1.25 per step)
+		float density;					// per slot and phase, some vehicles arrive
+		int maxArrivals;				// 1 .. maxArrivals of them
+		unsigned int repeats;			// timed solves per solver and case, the fastest counts
+		unsigned long long maxPaths;	// per reference solve, 0 = no limit
+		float warmUnchanged;			// warm modes: share of T the horizon solved before each timed solve shares
+
+		CopDifferentialOptions() : cases(100), seed(1), minHorizon(12), maxHorizon(24), maxRed(3), maxMinGreen(3),
+			maxGreenSpan(8), satFlowChance(0.7f), density(0.4f), maxArrivals(2), repeats(5), maxPaths(2000000),
+			warmUnchanged(0.5f)
+		{
+		}
+	};
+
+	/*
+	* One way of running Cop, to be compared with the scalar serial baseline
+	*/
+	struct CopDifferentialMode
+	{
+		std::string name;
+		bool vectorized;
+		bool pruning;
+		int threads;
+		bool longHorizon;
+		bool warmStart;			// each timed solve follows one of a horizon changed past options.warmUnchanged
+		bool lazy;
+
+		CopDifferentialMode() : vectorized(false), pruning(false), threads(1), longHorizon(false), warmStart(false), lazy(false) {}
+		CopDifferentialMode(const std::string& name, bool vectorized, bool pruning, int threads, bool longHorizon, bool warmStart, bool lazy = false)
+			: name(name), vectorized(vectorized), pruning(pruning), threads(threads), longHorizon(longHorizon), warmStart(warmStart), lazy(lazy) {}
+	};
+
+	/*
+	* One random case: the baseline DP against the exhaustive optimum of as
+	* many stages
+	*/
+	struct CopDifferentialCase
+	{
+		CopJunction junction;
+		unsigned int stages;		// of the baseline sequence
+		int value;					// v_j(T) of the baseline
+		int evaluated;				// CopReference::evaluate of its sequence
+		bool clamped;				// see CopReference::isClamped
+		bool consistent;			// value == evaluated
+		int optimum;				// exhaustive, of as many stages
+		unsigned long long paths;
+		bool complete;				// every path walked
+		double seconds;				// baseline, fastest of the repeats
+		double referenceSeconds;
+		bool original;				// solved by CopOriginal too, see CopDifferential
+		bool originalIdentical;		// it gave the baseline sequence
+		double originalSeconds;		// fastest of the repeats
+	};
+
+	/*
+	* One mode on one case
+	*/
+	struct CopDifferentialRecord
+	{
+		unsigned int testCase;
+		unsigned int mode;
+		int value;
+		bool identical;				// same sequence and value as the baseline
+		double seconds;				// fastest of the repeats
+		double speedup;				// baseline seconds / seconds
+		double originalSpeedup;		// original seconds / seconds, 0 without it
+	};
+
+	/*
+	* How the last run went. An inconsistent baseline or a mode that differs
+	* from it is a change of results; above the optimum is what the DP gives
+	* away by not carrying queues in its states, to be kept as it is.
+	*/
+	struct CopDifferentialStats
+	{
+		unsigned int cases;
+		unsigned int inconsistent;	// red = 1, nothing clamped, value != evaluated
+		unsigned int indexQuirks;	// value != evaluated otherwise, see CopReference
+		unsigned int aboveOptimum;	// evaluated > optimum, complete cases only
+		unsigned int belowOptimum;	// value < optimum, the DP tables hold other queues
+		unsigned int incomplete;	// reference gave up at maxPaths
+		double meanGap;				// (evaluated - optimum) / optimum over complete cases, optimum > 0
+		double referenceRatio;		// reference seconds / baseline seconds, geometric mean
+		std::vector<unsigned int> differences;	// per mode, cases not identical
+		std::vector<double> speedups;			// per mode, geometric mean
+		unsigned int originalCases;		// solved by CopOriginal too
+		unsigned int originalDifferences;	// of them, baseline sequence not the original's
+		double originalSpeedup;			// original seconds / baseline seconds, geometric mean
+		std::vector<double> originalSpeedups;	// per mode, original seconds / seconds, geometric mean
+		double seconds;				// wall time of the whole run
+	};
+
+	/*
+	* Differential check of Cop: random junctions and arrival tables are
+	* solved by the scalar serial DP, the baseline, whose sequence is scored
+	* by CopReference and set against the exhaustive optimum, and then by
+	* every mode, each of which must give the baseline sequence and value.
+	* With 3 phases, delay, the linear discharge and T >= M, which is all
+	* it handles, CopOriginal solves the case too: the baseline must give its
+	* sequence, and the speedups are also taken against it.
+	* The solves are timed, so one run shows a mode both unchanged and how
+	* much faster it is. Everything runs on the calling thread but the
+	* modes' own workers, to keep the timings clean.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopDifferential
+	{
+	public:
+		CopDifferential();	//with the modes vector, prune, threads, long, warm, lazy and all
+		void setOptions(const CopDifferentialOptions& options);
+		CopDifferentialOptions getOptions();
+		void setModes(const std::vector<CopDifferentialMode>& modes);
+		std::vector<CopDifferentialMode> getModes();
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//NULL = linear
+
+		CopDifferentialStats run();
+		CopDifferentialStats getStats();
+		const CopDifferentialCase& getCase(unsigned int k);
+		const CopDifferentialRecord& getRecord(unsigned int k, unsigned int mode);
+		void writeCsv(std::ostream& out);	//one line per case and mode, "baseline" and "original" first
+
+	private:
+		void draw(unsigned int k, CopJunction& junction, std::vector<std::vector<int> >& arrivals);
+		double timeSolve(Cop<NPhases, Objective>& cop, const CopDifferentialMode& mode, const CopJunction& junction,
+			const std::vector<std::vector<int> >& arrivals);	//fastest of the repeats, the result left in cop
+		double timeOriginal(const CopJunction& junction, const std::vector<std::vector<int> >& arrivals,
+			std::vector<int>& sequence);	//fastest of the repeats
+
+		CopDifferentialOptions options;
+		std::vector<CopDifferentialMode> modes;
+		std::shared_ptr<CopDischargeProfile> profile;
+		CopReference<NPhases, Objective> reference;
+
+		std::vector<CopDifferentialCase> cases;
+		std::vector<CopDifferentialRecord> records;	// [k * modes + mode]
+		CopDifferentialStats stats;
+	};
+
+	// defined in CopDifferential.cpp
+	extern template class COPDIFFERENTIAL_API CopDifferential<2, COP_QUEUES>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<2, COP_STOPS>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<2, COP_DELAY>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<3, COP_QUEUES>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<3, COP_STOPS>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<3, COP_DELAY>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<4, COP_QUEUES>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<4, COP_STOPS>;
+	extern template class COPDIFFERENTIAL_API CopDifferential<4, COP_DELAY>;
+}
+
+#endif
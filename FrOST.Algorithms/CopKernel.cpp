@@ -0,0 +1,612 @@
+// Candidate-green kernels for the COP recursion, picked at runtime by CPU
+#include <climits>
+#include "CopKernel.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define COP_KERNEL_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define COP_TARGET_AVX2
+#define COP_TARGET_SSE41
+#else
+#define COP_TARGET_AVX2 __attribute__((target("avx2")))
+#define COP_TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+#endif
+
+namespace COP97A{
+
+	/* ---------------------------------------------------------------------
+	* scalar, same arithmetic as Cop97A::evaluateGreen for xj > 0, j > 1
+	* --------------------------------------------------------------------- */
+
+	static inline int maxInt(int a, int b) { return a > b ? a : b; }
+	static inline int minInt(int a, int b) { return a < b ? a : b; }
+
+	static int evaluateCandidate(const CopCandidateInputs& in, int k)
+	{
+		int sj = in.sj;
+		int tp = sj - in.red;		// si + xj
+		int xj = in.firstGreen + k;
+		int si = tp - xj;
+
+		int maxQ = -1;
+		int stops = 0;
+		int delay = 0;
+
+		for (int p = 0; p < in.nPhases; p++) {
+			const int* C = in.cumArrivals[p];
+			int q = in.queues[p][si];
+			int tQueue, tStops, tDelay;
+
+			if (p != in.current) {
+				int a = C[sj] - C[si];
+				tQueue = q + a;
+				tStops = a;
+				int b = sj * (in.cumRequests[p][sj] - in.cumRequests[p][si])
+					- (in.cumRequestTimes[p][sj] - in.cumRequestTimes[p][si]);
+				tDelay = q * (sj - si) + b;
+			} else {
+				int a1 = C[tp] - C[si];
+				int a2 = C[sj] - C[tp];
+				int m = in.discharged[xj];
+				int b = sj * (in.cumRequests[p][sj] - in.cumRequests[p][tp])
+					- (in.cumRequestTimes[p][sj] - in.cumRequestTimes[p][tp]);
+				tQueue = maxInt(0, q + a1 - m) + a2;
+				tStops = maxInt(0, a1 - maxInt(0, m - q)) + a2;
+				tDelay = in.dischargeTimes[minInt(minInt(q, m), in.dischargeLast)]
+					+ maxInt(0, q - m) * (sj - si) + b;
+			}
+
+			maxQ = maxInt(maxQ, tQueue);
+			stops += tStops;
+			delay += tDelay;
+		}
+
+		int v = in.values[si >= in.red ? si - in.red : si];
+
+		switch (in.objective) {
+		case COP_QUEUES:
+			return maxInt(maxQ, v);
+		case COP_STOPS:
+			return stops + v;
+		default:
+			return delay + v;
+		}
+	}
+
+	static void candidatesScalarRange(const CopCandidateInputs& in, int k, CopCandidateResult& out)
+	{
+		for (; k < in.count; k++) {
+			int value = evaluateCandidate(in, k);
+			if (out.value > value) {
+				out.value = value;
+				out.index = k;
+			}
+		}
+	}
+
+	static void candidatesScalar(const CopCandidateInputs& in, CopCandidateResult& out)
+	{
+		out.value = INT_MAX;
+		out.index = -1;
+		candidatesScalarRange(in, 0, out);
+	}
+
+	static void candidatesMultiScalar(const CopCandidateInputs in[], CopCandidateResult out[])
+	{
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++)
+			candidatesScalar(in[o], out[o]);
+	}
+
+#ifdef COP_KERNEL_X86
+
+	static inline int firstLane(int mask)
+	{
+		int lane = 0;
+		while (!(mask & 1)) {
+			mask >>= 1;
+			lane++;
+		}
+		return lane;
+	}
+
+	/* ---------------------------------------------------------------------
+	* AVX2, 8 candidates per step. Lane l holds xj = x0 + l, whose si is
+	* s0 - l, so every table is one unaligned load reversed.
+	* --------------------------------------------------------------------- */
+
+	COP_TARGET_AVX2 static inline __m256i loadReversed8(const int* row, int sLow)
+	{
+		__m256i x = _mm256_loadu_si256((const __m256i*)(row + sLow));
+		return _mm256_permutevar8x32_epi32(x, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+	}
+
+	COP_TARGET_AVX2 static inline int horizontalMin8(__m256i x)
+	{
+		__m256i m = _mm256_min_epi32(x, _mm256_permute2x128_si256(x, x, 1));
+		m = _mm256_min_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm256_min_epi32(m, _mm256_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(_mm256_castsi256_si128(m));
+	}
+
+	COP_TARGET_AVX2 static void candidatesAvx2(const CopCandidateInputs& in, CopCandidateResult& out)
+	{
+		out.value = INT_MAX;
+		out.index = -1;
+
+		int sj = in.sj;
+		int tp = sj - in.red;
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256i vSj = _mm256_set1_epi32(sj);
+		const __m256i vTp = _mm256_set1_epi32(tp);
+		const __m256i vRed = _mm256_set1_epi32(in.red);
+		const __m256i vRedLess = _mm256_set1_epi32(in.red - 1);
+		const __m256i vLast = _mm256_set1_epi32(in.dischargeLast);
+
+		int k = 0;
+		for (; k + 8 <= in.count; k += 8) {
+			int x0 = in.firstGreen + k;
+			int sLow = tp - (x0 + 7);	// si of lane 7
+			__m256i x = _mm256_add_epi32(_mm256_set1_epi32(x0), lanes);
+			__m256i si = _mm256_sub_epi32(vTp, x);
+			__m256i span = _mm256_sub_epi32(vSj, si);
+
+			__m256i maxQ = _mm256_set1_epi32(-1);
+			__m256i stops = zero;
+			__m256i delay = zero;
+
+			for (int p = 0; p < in.nPhases; p++) {
+				const int* C = in.cumArrivals[p];
+				const int* N = in.cumRequests[p];
+				const int* W = in.cumRequestTimes[p];
+				__m256i q = loadReversed8(in.queues[p], sLow);
+				__m256i tQueue, tStops, tDelay;
+
+				if (p != in.current) {
+					__m256i a = _mm256_sub_epi32(_mm256_set1_epi32(C[sj]), loadReversed8(C, sLow));
+					__m256i n = _mm256_sub_epi32(_mm256_set1_epi32(N[sj]), loadReversed8(N, sLow));
+					__m256i w = _mm256_sub_epi32(_mm256_set1_epi32(W[sj]), loadReversed8(W, sLow));
+					tQueue = _mm256_add_epi32(q, a);
+					tStops = a;
+					tDelay = _mm256_add_epi32(_mm256_mullo_epi32(q, span),
+						_mm256_sub_epi32(_mm256_mullo_epi32(vSj, n), w));
+				} else {
+					__m256i a1 = _mm256_sub_epi32(_mm256_set1_epi32(C[tp]), loadReversed8(C, sLow));
+					__m256i a2 = _mm256_set1_epi32(C[sj] - C[tp]);
+					__m256i b = _mm256_set1_epi32(sj * (N[sj] - N[tp]) - (W[sj] - W[tp]));
+
+					__m256i m = _mm256_loadu_si256((const __m256i*)(in.discharged + x0));
+
+					tQueue = _mm256_add_epi32(_mm256_max_epi32(zero,
+						_mm256_sub_epi32(_mm256_add_epi32(q, a1), m)), a2);
+					tStops = _mm256_add_epi32(_mm256_max_epi32(zero,
+						_mm256_sub_epi32(a1, _mm256_max_epi32(zero, _mm256_sub_epi32(m, q)))), a2);
+
+					__m256i d = _mm256_min_epi32(_mm256_min_epi32(q, m), vLast);
+					__m256i td = _mm256_i32gather_epi32(in.dischargeTimes, d, 4);
+
+					tDelay = _mm256_add_epi32(_mm256_add_epi32(td,
+						_mm256_mullo_epi32(_mm256_max_epi32(zero, _mm256_sub_epi32(q, m)), span)), b);
+				}
+
+				maxQ = _mm256_max_epi32(maxQ, tQueue);
+				stops = _mm256_add_epi32(stops, tStops);
+				delay = _mm256_add_epi32(delay, tDelay);
+			}
+
+			// si -= red when si >= red
+			__m256i vIndex = _mm256_sub_epi32(si, _mm256_and_si256(_mm256_cmpgt_epi32(si, vRedLess), vRed));
+			__m256i v = _mm256_i32gather_epi32(in.values, vIndex, 4);
+
+			__m256i value;
+			switch (in.objective) {
+			case COP_QUEUES:
+				value = _mm256_max_epi32(maxQ, v);
+				break;
+			case COP_STOPS:
+				value = _mm256_add_epi32(stops, v);
+				break;
+			default:
+				value = _mm256_add_epi32(delay, v);
+				break;
+			}
+
+			int blockMin = horizontalMin8(value);
+			if (out.value > blockMin) {	// first lane reaching it, as the scalar loop
+				int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+					_mm256_cmpeq_epi32(value, _mm256_set1_epi32(blockMin))));
+				out.value = blockMin;
+				out.index = k + firstLane(mask);
+			}
+		}
+
+		candidatesScalarRange(in, k, out);
+	}
+
+	/*
+	* AVX2, every objective per step: the arrival terms are loaded once and
+	* each objective only adds its own queue loads and value gather
+	*/
+	COP_TARGET_AVX2 static void candidatesMultiAvx2(const CopCandidateInputs in[], CopCandidateResult out[])
+	{
+		const CopCandidateInputs& shared = in[COP_QUEUES];
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+			out[o].value = INT_MAX;
+			out[o].index = -1;
+		}
+
+		int sj = shared.sj;
+		int tp = sj - shared.red;
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256i vSj = _mm256_set1_epi32(sj);
+		const __m256i vTp = _mm256_set1_epi32(tp);
+		const __m256i vRed = _mm256_set1_epi32(shared.red);
+		const __m256i vRedLess = _mm256_set1_epi32(shared.red - 1);
+		const __m256i vLast = _mm256_set1_epi32(shared.dischargeLast);
+
+		int k = 0;
+		for (; k + 8 <= shared.count; k += 8) {
+			int x0 = shared.firstGreen + k;
+			int sLow = tp - (x0 + 7);	// si of lane 7
+			__m256i x = _mm256_add_epi32(_mm256_set1_epi32(x0), lanes);
+			__m256i si = _mm256_sub_epi32(vTp, x);
+			__m256i span = _mm256_sub_epi32(vSj, si);
+
+			__m256i m = _mm256_loadu_si256((const __m256i*)(shared.discharged + x0));
+
+			__m256i maxQ = _mm256_set1_epi32(-1);
+			__m256i stops = zero;
+			__m256i delay = zero;
+
+			for (int p = 0; p < shared.nPhases; p++) {
+				const int* C = shared.cumArrivals[p];
+				const int* N = shared.cumRequests[p];
+				const int* W = shared.cumRequestTimes[p];
+				__m256i qQueues = loadReversed8(in[COP_QUEUES].queues[p], sLow);
+				__m256i qStops = loadReversed8(in[COP_STOPS].queues[p], sLow);
+				__m256i qDelay = loadReversed8(in[COP_DELAY].queues[p], sLow);
+
+				if (p != shared.current) {
+					__m256i a = _mm256_sub_epi32(_mm256_set1_epi32(C[sj]), loadReversed8(C, sLow));
+					__m256i n = _mm256_sub_epi32(_mm256_set1_epi32(N[sj]), loadReversed8(N, sLow));
+					__m256i w = _mm256_sub_epi32(_mm256_set1_epi32(W[sj]), loadReversed8(W, sLow));
+					maxQ = _mm256_max_epi32(maxQ, _mm256_add_epi32(qQueues, a));
+					stops = _mm256_add_epi32(stops, a);
+					delay = _mm256_add_epi32(delay, _mm256_add_epi32(_mm256_mullo_epi32(qDelay, span),
+						_mm256_sub_epi32(_mm256_mullo_epi32(vSj, n), w)));
+				} else {
+					__m256i a1 = _mm256_sub_epi32(_mm256_set1_epi32(C[tp]), loadReversed8(C, sLow));
+					__m256i a2 = _mm256_set1_epi32(C[sj] - C[tp]);
+					__m256i b = _mm256_set1_epi32(sj * (N[sj] - N[tp]) - (W[sj] - W[tp]));
+
+					maxQ = _mm256_max_epi32(maxQ, _mm256_add_epi32(_mm256_max_epi32(zero,
+						_mm256_sub_epi32(_mm256_add_epi32(qQueues, a1), m)), a2));
+					stops = _mm256_add_epi32(stops, _mm256_add_epi32(_mm256_max_epi32(zero,
+						_mm256_sub_epi32(a1, _mm256_max_epi32(zero, _mm256_sub_epi32(m, qStops)))), a2));
+
+					__m256i d = _mm256_min_epi32(_mm256_min_epi32(qDelay, m), vLast);
+					__m256i td = _mm256_i32gather_epi32(shared.dischargeTimes, d, 4);
+
+					delay = _mm256_add_epi32(delay, _mm256_add_epi32(_mm256_add_epi32(td,
+						_mm256_mullo_epi32(_mm256_max_epi32(zero, _mm256_sub_epi32(qDelay, m)), span)), b));
+				}
+			}
+
+			__m256i vIndex = _mm256_sub_epi32(si, _mm256_and_si256(_mm256_cmpgt_epi32(si, vRedLess), vRed));
+			__m256i value[COP_OBJECTIVE_COUNT];
+			value[COP_QUEUES] = _mm256_max_epi32(maxQ, _mm256_i32gather_epi32(in[COP_QUEUES].values, vIndex, 4));
+			value[COP_STOPS] = _mm256_add_epi32(stops, _mm256_i32gather_epi32(in[COP_STOPS].values, vIndex, 4));
+			value[COP_DELAY] = _mm256_add_epi32(delay, _mm256_i32gather_epi32(in[COP_DELAY].values, vIndex, 4));
+
+			for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+				int blockMin = horizontalMin8(value[o]);
+				if (out[o].value > blockMin) {
+					int mask = _mm256_movemask_ps(_mm256_castsi256_ps(
+						_mm256_cmpeq_epi32(value[o], _mm256_set1_epi32(blockMin))));
+					out[o].value = blockMin;
+					out[o].index = k + firstLane(mask);
+				}
+			}
+		}
+
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++)
+			candidatesScalarRange(in[o], k, out[o]);
+	}
+
+	/* ---------------------------------------------------------------------
+	* SSE4.1, 4 candidates per step, same layout as the AVX2 kernel
+	* --------------------------------------------------------------------- */
+
+	COP_TARGET_SSE41 static inline __m128i loadReversed4(const int* row, int sLow)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(row + sLow));
+		return _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+	}
+
+	COP_TARGET_SSE41 static inline __m128i gather4(const int* table, __m128i index)	// no gather before AVX2
+	{
+		return _mm_setr_epi32(table[_mm_cvtsi128_si32(index)], table[_mm_extract_epi32(index, 1)],
+			table[_mm_extract_epi32(index, 2)], table[_mm_extract_epi32(index, 3)]);
+	}
+
+	COP_TARGET_SSE41 static inline int horizontalMin4(__m128i x)
+	{
+		__m128i m = _mm_min_epi32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm_min_epi32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(m);
+	}
+
+	COP_TARGET_SSE41 static void candidatesSse41(const CopCandidateInputs& in, CopCandidateResult& out)
+	{
+		out.value = INT_MAX;
+		out.index = -1;
+
+		int sj = in.sj;
+		int tp = sj - in.red;
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128i vSj = _mm_set1_epi32(sj);
+		const __m128i vTp = _mm_set1_epi32(tp);
+		const __m128i vLast = _mm_set1_epi32(in.dischargeLast);
+
+		int k = 0;
+		for (; k + 4 <= in.count; k += 4) {
+			int x0 = in.firstGreen + k;
+			int sLow = tp - (x0 + 3);	// si of lane 3
+			__m128i x = _mm_add_epi32(_mm_set1_epi32(x0), lanes);
+			__m128i si = _mm_sub_epi32(vTp, x);
+			__m128i span = _mm_sub_epi32(vSj, si);
+
+			__m128i maxQ = _mm_set1_epi32(-1);
+			__m128i stops = zero;
+			__m128i delay = zero;
+
+			for (int p = 0; p < in.nPhases; p++) {
+				const int* C = in.cumArrivals[p];
+				const int* N = in.cumRequests[p];
+				const int* W = in.cumRequestTimes[p];
+				__m128i q = loadReversed4(in.queues[p], sLow);
+				__m128i tQueue, tStops, tDelay;
+
+				if (p != in.current) {
+					__m128i a = _mm_sub_epi32(_mm_set1_epi32(C[sj]), loadReversed4(C, sLow));
+					__m128i n = _mm_sub_epi32(_mm_set1_epi32(N[sj]), loadReversed4(N, sLow));
+					__m128i w = _mm_sub_epi32(_mm_set1_epi32(W[sj]), loadReversed4(W, sLow));
+					tQueue = _mm_add_epi32(q, a);
+					tStops = a;
+					tDelay = _mm_add_epi32(_mm_mullo_epi32(q, span),
+						_mm_sub_epi32(_mm_mullo_epi32(vSj, n), w));
+				} else {
+					__m128i a1 = _mm_sub_epi32(_mm_set1_epi32(C[tp]), loadReversed4(C, sLow));
+					__m128i a2 = _mm_set1_epi32(C[sj] - C[tp]);
+					__m128i b = _mm_set1_epi32(sj * (N[sj] - N[tp]) - (W[sj] - W[tp]));
+
+					__m128i m = _mm_loadu_si128((const __m128i*)(in.discharged + x0));
+
+					tQueue = _mm_add_epi32(_mm_max_epi32(zero,
+						_mm_sub_epi32(_mm_add_epi32(q, a1), m)), a2);
+					tStops = _mm_add_epi32(_mm_max_epi32(zero,
+						_mm_sub_epi32(a1, _mm_max_epi32(zero, _mm_sub_epi32(m, q)))), a2);
+
+					__m128i d = _mm_min_epi32(_mm_min_epi32(q, m), vLast);
+					__m128i td = gather4(in.dischargeTimes, d);
+
+					tDelay = _mm_add_epi32(_mm_add_epi32(td,
+						_mm_mullo_epi32(_mm_max_epi32(zero, _mm_sub_epi32(q, m)), span)), b);
+				}
+
+				maxQ = _mm_max_epi32(maxQ, tQueue);
+				stops = _mm_add_epi32(stops, tStops);
+				delay = _mm_add_epi32(delay, tDelay);
+			}
+
+			// no gather before AVX2
+			int s0 = sLow + 3;
+			__m128i v = _mm_setr_epi32(
+				in.values[s0 >= in.red ? s0 - in.red : s0],
+				in.values[s0 - 1 >= in.red ? s0 - 1 - in.red : s0 - 1],
+				in.values[s0 - 2 >= in.red ? s0 - 2 - in.red : s0 - 2],
+				in.values[sLow >= in.red ? sLow - in.red : sLow]);
+
+			__m128i value;
+			switch (in.objective) {
+			case COP_QUEUES:
+				value = _mm_max_epi32(maxQ, v);
+				break;
+			case COP_STOPS:
+				value = _mm_add_epi32(stops, v);
+				break;
+			default:
+				value = _mm_add_epi32(delay, v);
+				break;
+			}
+
+			int blockMin = horizontalMin4(value);
+			if (out.value > blockMin) {
+				int mask = _mm_movemask_ps(_mm_castsi128_ps(
+					_mm_cmpeq_epi32(value, _mm_set1_epi32(blockMin))));
+				out.value = blockMin;
+				out.index = k + firstLane(mask);
+			}
+		}
+
+		candidatesScalarRange(in, k, out);
+	}
+
+	COP_TARGET_SSE41 static void candidatesMultiSse41(const CopCandidateInputs in[], CopCandidateResult out[])
+	{
+		const CopCandidateInputs& shared = in[COP_QUEUES];
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+			out[o].value = INT_MAX;
+			out[o].index = -1;
+		}
+
+		int sj = shared.sj;
+		int tp = sj - shared.red;
+		int red = shared.red;
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+		const __m128i vSj = _mm_set1_epi32(sj);
+		const __m128i vTp = _mm_set1_epi32(tp);
+		const __m128i vLast = _mm_set1_epi32(shared.dischargeLast);
+
+		int k = 0;
+		for (; k + 4 <= shared.count; k += 4) {
+			int x0 = shared.firstGreen + k;
+			int sLow = tp - (x0 + 3);	// si of lane 3
+			__m128i x = _mm_add_epi32(_mm_set1_epi32(x0), lanes);
+			__m128i si = _mm_sub_epi32(vTp, x);
+			__m128i span = _mm_sub_epi32(vSj, si);
+
+			__m128i m = _mm_loadu_si128((const __m128i*)(shared.discharged + x0));
+
+			__m128i maxQ = _mm_set1_epi32(-1);
+			__m128i stops = zero;
+			__m128i delay = zero;
+
+			for (int p = 0; p < shared.nPhases; p++) {
+				const int* C = shared.cumArrivals[p];
+				const int* N = shared.cumRequests[p];
+				const int* W = shared.cumRequestTimes[p];
+				__m128i qQueues = loadReversed4(in[COP_QUEUES].queues[p], sLow);
+				__m128i qStops = loadReversed4(in[COP_STOPS].queues[p], sLow);
+				__m128i qDelay = loadReversed4(in[COP_DELAY].queues[p], sLow);
+
+				if (p != shared.current) {
+					__m128i a = _mm_sub_epi32(_mm_set1_epi32(C[sj]), loadReversed4(C, sLow));
+					__m128i n = _mm_sub_epi32(_mm_set1_epi32(N[sj]), loadReversed4(N, sLow));
+					__m128i w = _mm_sub_epi32(_mm_set1_epi32(W[sj]), loadReversed4(W, sLow));
+					maxQ = _mm_max_epi32(maxQ, _mm_add_epi32(qQueues, a));
+					stops = _mm_add_epi32(stops, a);
+					delay = _mm_add_epi32(delay, _mm_add_epi32(_mm_mullo_epi32(qDelay, span),
+						_mm_sub_epi32(_mm_mullo_epi32(vSj, n), w)));
+				} else {
+					__m128i a1 = _mm_sub_epi32(_mm_set1_epi32(C[tp]), loadReversed4(C, sLow));
+					__m128i a2 = _mm_set1_epi32(C[sj] - C[tp]);
+					__m128i b = _mm_set1_epi32(sj * (N[sj] - N[tp]) - (W[sj] - W[tp]));
+
+					maxQ = _mm_max_epi32(maxQ, _mm_add_epi32(_mm_max_epi32(zero,
+						_mm_sub_epi32(_mm_add_epi32(qQueues, a1), m)), a2));
+					stops = _mm_add_epi32(stops, _mm_add_epi32(_mm_max_epi32(zero,
+						_mm_sub_epi32(a1, _mm_max_epi32(zero, _mm_sub_epi32(m, qStops)))), a2));
+
+					__m128i d = _mm_min_epi32(_mm_min_epi32(qDelay, m), vLast);
+					__m128i td = gather4(shared.dischargeTimes, d);
+
+					delay = _mm_add_epi32(delay, _mm_add_epi32(_mm_add_epi32(td,
+						_mm_mullo_epi32(_mm_max_epi32(zero, _mm_sub_epi32(qDelay, m)), span)), b));
+				}
+			}
+
+			// no gather before AVX2
+			int s0 = sLow + 3;
+			int i0 = s0 >= red ? s0 - red : s0;
+			int i1 = s0 - 1 >= red ? s0 - 1 - red : s0 - 1;
+			int i2 = s0 - 2 >= red ? s0 - 2 - red : s0 - 2;
+			int i3 = sLow >= red ? sLow - red : sLow;
+			const int* vQueues = in[COP_QUEUES].values;
+			const int* vStops = in[COP_STOPS].values;
+			const int* vDelay = in[COP_DELAY].values;
+
+			__m128i value[COP_OBJECTIVE_COUNT];
+			value[COP_QUEUES] = _mm_max_epi32(maxQ, _mm_setr_epi32(vQueues[i0], vQueues[i1], vQueues[i2], vQueues[i3]));
+			value[COP_STOPS] = _mm_add_epi32(stops, _mm_setr_epi32(vStops[i0], vStops[i1], vStops[i2], vStops[i3]));
+			value[COP_DELAY] = _mm_add_epi32(delay, _mm_setr_epi32(vDelay[i0], vDelay[i1], vDelay[i2], vDelay[i3]));
+
+			for (int o = 0; o < COP_OBJECTIVE_COUNT; o++) {
+				int blockMin = horizontalMin4(value[o]);
+				if (out[o].value > blockMin) {
+					int mask = _mm_movemask_ps(_mm_castsi128_ps(
+						_mm_cmpeq_epi32(value[o], _mm_set1_epi32(blockMin))));
+					out[o].value = blockMin;
+					out[o].index = k + firstLane(mask);
+				}
+			}
+		}
+
+		for (int o = 0; o < COP_OBJECTIVE_COUNT; o++)
+			candidatesScalarRange(in[o], k, out[o]);
+	}
+
+	/* ---------------------------------------------------------------------
+	* dispatch
+	* --------------------------------------------------------------------- */
+
+#if defined(_MSC_VER)
+	static bool cpuHasAvx2()
+	{
+		int r[4];
+		__cpuid(r, 0);
+		if (r[0] < 7)
+			return false;
+
+		__cpuid(r, 1);
+		bool osAvx = (r[2] & (1 << 27)) && (r[2] & (1 << 28));	// OSXSAVE, AVX
+		if (!osAvx || (_xgetbv(0) & 6) != 6)	// ymm state saved by the OS
+			return false;
+
+		__cpuidex(r, 7, 0);
+		return (r[1] & (1 << 5)) != 0;
+	}
+
+	static bool cpuHasSse41()
+	{
+		int r[4];
+		__cpuid(r, 1);
+		return (r[2] & (1 << 19)) != 0;
+	}
+#else
+	static bool cpuHasAvx2() { return __builtin_cpu_supports("avx2") != 0; }
+	static bool cpuHasSse41() { return __builtin_cpu_supports("sse4.1") != 0; }
+#endif
+
+#endif // COP_KERNEL_X86
+
+	CopCandidateKernel getCandidateKernel()
+	{
+#ifdef COP_KERNEL_X86
+		static const CopCandidateKernel best = cpuHasAvx2() ? candidatesAvx2
+			: (cpuHasSse41() ? candidatesSse41 : candidatesScalar);
+		return best;
+#else
+		return candidatesScalar;
+#endif
+	}
+
+	CopCandidateKernel getScalarCandidateKernel()
+	{
+		return candidatesScalar;
+	}
+
+	CopMultiCandidateKernel getMultiCandidateKernel()
+	{
+#ifdef COP_KERNEL_X86
+		static const CopMultiCandidateKernel best = cpuHasAvx2() ? candidatesMultiAvx2
+			: (cpuHasSse41() ? candidatesMultiSse41 : candidatesMultiScalar);
+		return best;
+#else
+		return candidatesMultiScalar;
+#endif
+	}
+
+	CopMultiCandidateKernel getScalarMultiCandidateKernel()
+	{
+		return candidatesMultiScalar;
+	}
+
+	const char* getCandidateKernelName()
+	{
+		CopCandidateKernel k = getCandidateKernel();
+#ifdef COP_KERNEL_X86
+		if (k == candidatesAvx2)
+			return "avx2";
+		if (k == candidatesSse41)
+			return "sse4.1";
+#endif
+		return "scalar";
+	}
+}
@@ -0,0 +1,65 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPKERNEL_API __declspec(dllexport) 
+#else
+#define COPKERNEL_API  __declspec(dllimport) 
+#endif
+
+#ifndef FROST_ALGORITHMS_COPKERNEL
+#define FROST_ALGORITHMS_COPKERNEL
+
+#define COP_MAX_PHASES 8
+#define COP_OBJECTIVE_COUNT 3
+
+namespace COP97A {
+
+	enum CopObjective {
+		COP_QUEUES, COP_STOPS, COP_DELAY	// also the index of per-objective tables
+	};
+
+	/*
+	* One state sj at stage j > 1 and its block of non-zero greens
+	* xj = firstGreen .. firstGreen + count - 1. For those si + xj = sj - red,
+	* so every table below is read at si = sj - red - xj, i.e. contiguously.
+	*/
+	struct CopCandidateInputs
+	{
+		int sj;
+		int red;
+		int firstGreen;
+		int count;
+		int nPhases;
+		int current;			// phase with right-of-way
+		int objective;			// CopObjective
+		const int* discharged;		// getM(current, x) == discharged[x], for every green of the block
+		const int* dischargeTimes;	// getT(d, current) == dischargeTimes[d], d <= dischargeLast
+		int dischargeLast;
+		const int* queues[COP_MAX_PHASES];		// getQ(si, phi, j - 1) == queues[phi][si]
+		const int* cumArrivals[COP_MAX_PHASES];	// prefix sums, see Cop97A::buildArrivalIndex
+		const int* cumRequests[COP_MAX_PHASES];
+		const int* cumRequestTimes[COP_MAX_PHASES];
+		const int* values;		// v_{j-1}
+	};
+
+	struct CopCandidateResult
+	{
+		int value;	// min over the block, INT_MAX if count == 0
+		int index;	// first candidate reaching it, offset from firstGreen
+	};
+
+	typedef void (*CopCandidateKernel)(const CopCandidateInputs&, CopCandidateResult&);
+
+	/*
+	* The same block for every objective at once, in[o] and out[o] indexed by
+	* CopObjective. Only queues and values differ between the inputs, the
+	* arrival terms are computed once.
+	*/
+	typedef void (*CopMultiCandidateKernel)(const CopCandidateInputs in[], CopCandidateResult out[]);
+
+	COPKERNEL_API CopCandidateKernel getCandidateKernel();	// AVX2, SSE4.1 or scalar, by CPU
+	COPKERNEL_API CopCandidateKernel getScalarCandidateKernel();
+	COPKERNEL_API const char* getCandidateKernelName();
+	COPKERNEL_API CopMultiCandidateKernel getMultiCandidateKernel();
+	COPKERNEL_API CopMultiCandidateKernel getScalarMultiCandidateKernel();
+}
+
+#endif
@@ -0,0 +1,276 @@
+// Coarse-to-fine COP
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "CopMultiResolution.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	CopScaledDischarge::CopScaledDischarge(shared_ptr<CopDischargeProfile> option, unsigned int steps)
+		: profile(option ? option : make_shared<CopLinearDischarge>()), factor(max(1u, steps))
+	{
+	}
+
+	int CopScaledDischarge::getM(int phi, int xj, float satRate, float lostTime)
+	{
+		return profile->getM(phi, xj * factor, satRate, lostTime);
+	}
+
+	int CopScaledDischarge::getT(int d, int phi, float satRate, float lostTime)
+	{
+		return (profile->getT(d, phi, satRate, lostTime) + factor - 1) / factor;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopMultiResolution<NPhases, Objective>::CopMultiResolution(int threads)
+		: coarse(0, 10), fine(0, 10), factor(4), band(0), measureGap(false)
+	{
+		fine.setThreads(threads);	// the coarse solve is small, it stays serial
+		junction.horizon = 0;	// so that setJunction lays out the arrivals
+		setJunction(CopJunction());
+
+		stats.factor = factor;
+		stats.band = stats.widenings = 0;
+		stats.value = stats.fullValue = 0;
+		stats.coarseSeconds = stats.fineSeconds = stats.fullSeconds = stats.gap = 0;
+		stats.fineStates = stats.fullStates = 0;
+		stats.measured = false;
+		stats.coarseCovers = false;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::configure(Cop<NPhases, Objective>& cop, unsigned int steps)
+	{
+		// greens and red to whole slots, discharge seen per slot
+		const int f = (int)steps;
+		cop.configure(junction);
+		if (f > 1) {
+			int mingreen = max(1, (junction.mingreen + f - 1) / f);
+			cop.setRedTime(max(1, (junction.red + f / 2) / f));
+			cop.setMinGreenTime(mingreen);
+			cop.setMaxGreenTime(max(mingreen, junction.maxgreen / f));
+		}
+		cop.setDischargeProfile(f == 1 ? profile : make_shared<CopScaledDischarge>(profile, steps));
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::setJunction(const CopJunction& option)
+	{
+		const bool relayout = option.horizon != junction.horizon;
+		junction = option;
+		if (relayout) {	// arrivals of another horizon are dropped
+			arrivals.assign(junction.horizon * NPhases, 0);
+			setFactor(factor);
+		}
+		else {
+			configure(coarse, factor);
+			configure(fine, 1);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopJunction CopMultiResolution<NPhases, Objective>::getJunction()
+	{
+		return junction;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::setArrivals(const vector<vector<int> >& data)
+	{
+		// slots past the end of data are taken as empty
+		const unsigned int T = junction.horizon;
+		fill(coarseArrivals.begin(), coarseArrivals.end(), 0);
+		for (unsigned int k = 0; k < T; k++) {
+			for (unsigned int phi = 0; phi < NPhases; phi++) {
+				arrivals[k * NPhases + phi] = k < data.size() && phi < data[k].size() ? data[k][phi] : 0;
+				coarseArrivals[(k / factor) * NPhases + phi] += arrivals[k * NPhases + phi];
+			}
+		}
+		if (T > 0) {
+			fine.setArrivals(&arrivals[0], T);
+			coarse.setArrivals(&coarseArrivals[0], (T + factor - 1) / factor);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::setDischargeProfile(shared_ptr<CopDischargeProfile> option)
+	{
+		profile = option;
+		configure(coarse, factor);
+		configure(fine, 1);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::setFactor(unsigned int steps)
+	{
+		factor = max(1u, steps);
+		configure(coarse, factor);
+		configure(fine, 1);
+
+		// coarse slots sum the arrivals of theirs, the last one may be short
+		const unsigned int T = junction.horizon;
+		const unsigned int slots = (T + factor - 1) / factor;
+		coarseArrivals.assign(slots * NPhases, 0);
+		for (unsigned int k = 0; k < T; k++)
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				coarseArrivals[(k / factor) * NPhases + phi] += arrivals[k * NPhases + phi];
+
+		fine.setHorizon(T);
+		coarse.setHorizon(slots);
+		if (T > 0) {
+			fine.setArrivals(&arrivals[0], T);
+			coarse.setArrivals(&coarseArrivals[0], slots);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::setBand(unsigned int steps)
+	{
+		band = steps;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::setMeasureGap(bool option)
+	{
+		measureGap = option;
+	}
+
+	// the greens and reds of sequence span the horizon, as placed back from it
+	template<unsigned int NPhases, CopObjective Objective>
+	bool CopMultiResolution<NPhases, Objective>::covers(const vector<int>& sequence, int red, int horizon)
+	{
+		int steps = 0;
+		for (unsigned int j = 0; j < sequence.size(); j++)
+			steps += sequence[j] != 0 ? sequence[j] + red : 0;
+		return steps >= horizon;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopMultiResolution<NPhases, Objective>::buildBand(unsigned int width)
+	{
+		// stage j ends within width of where the coarse one did, the last at T
+		const int T = (int)junction.horizon;
+		bandLow.resize(stageEnds.size());
+		bandHigh.resize(stageEnds.size());
+		for (unsigned int j = 0; j < stageEnds.size(); j++) {
+			bandLow[j] = max(0, stageEnds[j] - (int)width);
+			bandHigh[j] = min(T, stageEnds[j] + (int)width);
+		}
+		if (!bandHigh.empty())
+			bandHigh.back() = T;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopMultiResolution<NPhases, Objective>::solve()
+	{
+		const int T = (int)junction.horizon;
+		stats.factor = factor;
+		stats.widenings = 0;
+		stats.fineSeconds = stats.fullSeconds = stats.gap = 0;
+		stats.fineStates = 0;
+		stats.measured = stats.fullKept = false;
+
+		coarse.setInitialPhase(junction.initialPhase);	// a solve moves it on
+		coarse.solve();
+		const CopResult& rough = coarse.getResult();
+		stats.coarseSeconds = rough.stats.seconds;
+
+		// where each coarse stage ends, backtracked as recoverSequence does
+		const int red = coarse.getRed();
+		const int n = (int)rough.sequence.size();
+		stageEnds.resize(n);
+		int s = (T + factor - 1) / factor;
+		for (int j = n; j >= 1; j--) {
+			stageEnds[j - 1] = min(T, s * (int)factor);
+			int x = rough.sequence[j - 1];
+			s -= x != 0 ? x + red : 0;
+			if (s <= red)
+				s = red;
+		}
+
+		const int slots = (T + factor - 1) / factor;
+		stats.coarseCovers = covers(rough.sequence, red, slots);
+		unsigned int width = !stats.coarseCovers ? (unsigned int)T : band > 0 ? band : 2 * factor;
+		while (true) {
+			if (width < (unsigned int)T && !stageEnds.empty()) {
+				buildBand(width);
+				fine.setStateBand(bandLow, bandHigh);
+			}
+			else
+				fine.setStateBand(vector<int>(), vector<int>());
+
+			fine.setInitialPhase(junction.initialPhase);
+			fine.solve();
+			stats.fineSeconds += fine.getResult().stats.seconds;
+			stats.fineStates += fine.getWarmStartStats().statesComputed;
+			const CopResult& banded = fine.getResult();
+			const bool fits = banded.value < Cop<NPhases, Objective>::unreachable && covers(banded.sequence, junction.red, T);
+			if (fits || width >= (unsigned int)T)
+				break;
+			width *= 2;
+			stats.widenings++;
+		}
+
+		result.sequence.assign(fine.getResult().sequence.begin(), fine.getResult().sequence.end());	// reuses capacity
+		result.value = fine.getResult().value;
+		result.queues.assign(fine.getResult().queues.begin(), fine.getResult().queues.end());
+		result.stats = fine.getResult().stats;
+		result.stats.seconds = stats.coarseSeconds + stats.fineSeconds;
+
+		stats.band = min(width, (unsigned int)T);
+		stats.value = result.value;
+		stats.fullStates = (unsigned long long)(T - fine.getRed() + 1) * result.stats.stages;
+
+		// the full solve is at hand, so the better of the two is given
+		if (measureGap) {
+			fine.setStateBand(vector<int>(), vector<int>());
+			fine.setInitialPhase(junction.initialPhase);
+			fine.solve();
+			const CopResult& full = fine.getResult();
+			stats.measured = true;
+			stats.fullValue = full.value;
+			stats.fullSeconds = full.stats.seconds;
+			stats.gap = (double)(stats.value - stats.fullValue) / max(1, stats.fullValue);
+			if (full.value < result.value) {
+				result.sequence.assign(full.sequence.begin(), full.sequence.end());
+				result.value = full.value;
+				result.queues.assign(full.queues.begin(), full.queues.end());
+				result.stats = full.stats;
+				stats.fullKept = true;
+			}
+			result.stats.seconds = stats.coarseSeconds + stats.fineSeconds + stats.fullSeconds;
+		}
+		return (int)result.sequence.size();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopResult& CopMultiResolution<NPhases, Objective>::getResult()
+	{
+		return result;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> CopMultiResolution<NPhases, Objective>::getOptimalControl()
+	{
+		return result.sequence;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopMultiResolutionStats CopMultiResolution<NPhases, Objective>::getStats()
+	{
+		return stats;
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopMultiResolution<2, COP_QUEUES>;
+	template class CopMultiResolution<2, COP_STOPS>;
+	template class CopMultiResolution<2, COP_DELAY>;
+	template class CopMultiResolution<3, COP_QUEUES>;
+	template class CopMultiResolution<3, COP_STOPS>;
+	template class CopMultiResolution<3, COP_DELAY>;
+	template class CopMultiResolution<4, COP_QUEUES>;
+	template class CopMultiResolution<4, COP_STOPS>;
+	template class CopMultiResolution<4, COP_DELAY>;
+}
@@ -0,0 +1,118 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPMULTIRESOLUTION_API __declspec(dllexport)
+#else
+#define COPMULTIRESOLUTION_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPMULTIRESOLUTION
+#define FROST_ALGORITHMS_COPMULTIRESOLUTION
+
+#include "COP97A.h"
+#include <vector>
+
+namespace COP97A {
+
+	/*
+	* Another profile seen in slots of factor steps: a green of x slots
+	* clears what one of factor * x steps does, times are rounded up to slots
+	*/
+	class CopScaledDischarge : public CopDischargeProfile
+	{
+	public:
+		COPMULTIRESOLUTION_API CopScaledDischarge(std::shared_ptr<CopDischargeProfile> profile, unsigned int factor);	//NULL = linear
+		COPMULTIRESOLUTION_API int getM(int phi, int xj, float satRate, float lostTime);
+		COPMULTIRESOLUTION_API int getT(int d, int phi, float satRate, float lostTime);
+	private:
+		std::shared_ptr<CopDischargeProfile> profile;
+		int factor;
+	};
+
+	/*
+	* How the last multiresolution solve went
+	*/
+	struct CopMultiResolutionStats
+	{
+		unsigned int factor;		// steps per coarse slot
+		unsigned int band;			// steps either side of a coarse stage end, after widening
+		unsigned int widenings;		// band doubled as no sequence reaching T fitted in it
+		bool coarseCovers;			// the coarse sequence reaches its horizon, else no band
+		int value;					// v_j(T) of the banded solve
+		double coarseSeconds;
+		double fineSeconds;
+		unsigned long long fineStates;	// evaluated by the banded solve
+		unsigned long long fullStates;	// a full solve of as many stages evaluates
+		bool measured;				// the full solve below was run
+		int fullValue;
+		double fullSeconds;
+		double gap;					// (value - fullValue) / fullValue, 0 if not measured
+		bool fullKept;				// the full sequence was better and is the result
+	};
+
+	/*
+	* Coarse-to-fine COP: the DP first runs on slots of factor steps, with
+	* arrivals summed and greens, red and discharge scaled to them, then once
+	* more at full resolution evaluating only the states within band steps of
+	* where the coarse optimum ends each stage (Cop::setStateBand); stages
+	* past the coarse ones are not banded. A coarse sequence whose greens and
+	* reds fall short of the horizon gives no band. The band is doubled until
+	* a sequence fits in it that reaches T as well.
+	* The band is a heuristic with no bound on what it gives away: at T = 240,
+	* factor 4 and band 8, 31 of 200 random cases came out more than 5% above
+	* the full solve, the worst 53%, and 85 fell back to a full solve as the
+	* coarse plan fell short. The gap is only known by solving in full as
+	* well (setMeasureGap), and then the better sequence of the two is the
+	* result, for the time of both. States do not carry queues, so a band
+	* may also steer the DP to a path the full solve passed over, and the
+	* gap come out below 0.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopMultiResolution
+	{
+	public:
+		CopMultiResolution(int threads = 1);
+		void setJunction(const CopJunction& junction);
+		CopJunction getJunction();
+		void setArrivals(const std::vector<std::vector<int> >& arrivals);	//[slot][phase], as Cop::setArrivals
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//NULL = linear
+		void setFactor(unsigned int steps);	//per coarse slot, 4 by default (2 s of half second steps)
+		void setBand(unsigned int steps);	//either side, 0 = 2 * factor (default)
+		void setMeasureGap(bool);	//also solve in full and give the better sequence, off by default
+
+		int solve();	//gives the sequence length
+		const CopResult& getResult();	//of the banded solve, or the full one if measured and better
+		std::vector<int> getOptimalControl();
+		CopMultiResolutionStats getStats();
+
+	private:
+		void configure(Cop<NPhases, Objective>& cop, unsigned int factor);
+		void buildBand(unsigned int width);
+		static bool covers(const std::vector<int>& sequence, int red, int horizon);
+
+		Cop<NPhases, Objective> coarse, fine;
+		CopJunction junction;
+		std::shared_ptr<CopDischargeProfile> profile;
+		unsigned int factor;
+		unsigned int band;
+		bool measureGap;
+
+		std::vector<int> arrivals;			// [slot * NPhases + phase]
+		std::vector<int> coarseArrivals;	// summed over factor steps
+		std::vector<int> stageEnds;			// of the coarse optimum, in steps
+		std::vector<int> bandLow, bandHigh;
+		CopResult result;
+		CopMultiResolutionStats stats;
+	};
+
+	// defined in CopMultiResolution.cpp
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<2, COP_QUEUES>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<2, COP_STOPS>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<2, COP_DELAY>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<3, COP_QUEUES>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<3, COP_STOPS>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<3, COP_DELAY>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<4, COP_QUEUES>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<4, COP_STOPS>;
+	extern template class COPMULTIRESOLUTION_API CopMultiResolution<4, COP_DELAY>;
+}
+
+#endif
@@ -0,0 +1,309 @@
+// COP coordinated over a network of junctions
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "CopNetwork.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopNetwork<NPhases, Objective>::CopNetwork(unsigned int n, int nThreads)
+		: junctions(n), threads(nThreads < 1 ? 1 : nThreads), pool(nThreads < 1 ? 1 : nThreads), maxIterations(10)
+	{
+		for (unsigned int i = 0; i < n; i++) {
+			solvers.push_back(Cop<NPhases, Objective>(0, 10));	// serial, the round is split by junction
+			solvers[i].setWarmStart(true);
+		}
+		solverHorizon.assign(n, 10);
+		parameters.resize(n);
+		horizons.assign(n, 0);
+		locals.resize(n);
+		inflows.resize(n);
+		predicted.resize(n);
+		arrivals.resize(n);
+		departures.resize(n);
+		greens.resize(n);
+		sequences.resize(n);
+		values.assign(n, 0);
+		for (unsigned int i = 0; i < n; i++)
+			setJunction(i, CopJunction());
+
+		stats.iterations = 0;
+		stats.converged = stats.deadlineHit = false;
+		stats.seconds = 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int CopNetwork<NPhases, Objective>::size()
+	{
+		return junctions;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopNetwork<NPhases, Objective>::getThreads()
+	{
+		return threads;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::setJunction(unsigned int i, const CopJunction& junction)
+	{
+		solvers[i].configure(junction);
+		parameters[i] = junction;
+
+		if (junction.horizon != horizons[i]) {	// arrivals of another horizon are dropped
+			horizons[i] = junction.horizon;
+			locals[i].assign(NPhases * junction.horizon, 0);
+			inflows[i].assign(NPhases * junction.horizon, 0);
+			predicted[i].assign(NPhases * junction.horizon, 0);
+			arrivals[i].assign(NPhases * junction.horizon, 0);
+			departures[i].assign(NPhases * junction.horizon, 0);
+			greens[i].assign(2 * junction.horizon, 0);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopJunction CopNetwork<NPhases, Objective>::getJunction(unsigned int i)
+	{
+		return parameters[i];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::setArrivals(unsigned int i, const vector<vector<int> >& data)
+	{
+		// slots past the end of data are taken as empty
+		for (unsigned int k = 0; k < horizons[i]; k++)
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				local(i, phi, k) = k < data.size() && phi < data[k].size() ? data[k][phi] : 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::setDischargeProfile(unsigned int i, shared_ptr<CopDischargeProfile> profile)
+	{
+		solvers[i].setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopNetwork<NPhases, Objective>::addLink(const CopLink& link)
+	{
+		if (link.from >= junctions || link.to >= junctions || link.fromPhase < 0 || link.fromPhase >= (int)NPhases
+			|| link.toPhase < 0 || link.toPhase >= (int)NPhases)
+			return -1;
+		links.push_back(link);
+		return (int)links.size() - 1;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::clearLinks()
+	{
+		links.clear();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::setMaxIterations(unsigned int iterations)
+	{
+		maxIterations = max(1u, iterations);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::NodeTask::execute(unsigned int /*worker*/, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			network->solveNode(i);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::solveNode(unsigned int i)
+	{
+		Cop<NPhases, Objective>& cop = solvers[i];
+		const unsigned int T = horizons[i];
+
+		cop.setInitialPhase(parameters[i].initialPhase);	// a solve moves it on
+		if (solverHorizon[i] != T) {
+			cop.setHorizon(T);
+			solverHorizon[i] = T;
+		}
+		// in place, phases one row apart
+		cop.setArrivals(&arrivals[i][0], T, 1, T);
+
+		cop.solve(deadline);
+
+		const CopResult& result = cop.getResult();
+		sequences[i].assign(result.sequence.begin(), result.sequence.end());
+		values[i] = result.value;
+		discharge(i);
+	}
+
+	/*
+	* Plays the sequence of junction i on its arrivals, stage by stage as
+	* recoverSequence places them, and counts the vehicles leaving each phase
+	* per slot: by the end of slot x of a green, up to getM(x + 1) of the
+	* vehicles queued have gone, so that a green of x clears getM(x) as the
+	* solver assumed. Unbounded, no saturation flow set, the whole queue
+	* goes in every slot of the green.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopNetwork<NPhases, Objective>::discharge(unsigned int i)
+	{
+		Cop<NPhases, Objective>& cop = solvers[i];
+		const vector<int>& sequence = sequences[i];
+		const int T = (int)horizons[i];
+		const int red = parameters[i].red;
+		const int n = (int)sequence.size();
+		vector<int>& green = greens[i];
+		fill(green.begin(), green.end(), -1);
+
+		int sj = T;
+		for (int j = n; j >= 1; j--) {
+			const int x = sequence[j - 1];
+			const int si = j == 1 ? 0 : max(0, sj - (x != 0 ? x + red : 0));
+			int phase = parameters[i].initialPhase;
+			for (int k = 1; k < j; k++)
+				phase = Cop<NPhases, Objective>::nextPhase(phase);
+			for (int t = si; t < si + x && t < T; t++) {
+				green[2 * t] = phase;
+				green[2 * t + 1] = t - si;
+			}
+			sj = si <= red ? red : si;
+		}
+
+		for (unsigned int p = 0; p < NPhases; p++) {
+			const int* a = &arrivals[i][p * T];
+			int* out = &departures[i][p * T];
+			int queue = 0, cleared = 0;	// in the green so far
+			for (int t = 0; t < T; t++) {
+				queue += a[t];
+				out[t] = 0;
+				if (green[2 * t] == (int)p) {
+					int x = green[2 * t + 1];
+					if (x == 0)
+						cleared = 0;
+					out[t] = min(queue, max(0, cop.getM(p, x + 1) - cleared));
+					queue -= out[t];
+					cleared += out[t];
+				}
+			}
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	bool CopNetwork<NPhases, Objective>::predict()
+	{
+		for (unsigned int i = 0; i < junctions; i++)
+			fill(predicted[i].begin(), predicted[i].end(), 0);
+
+		for (unsigned int l = 0; l < links.size(); l++) {
+			const CopLink& link = links[l];
+			const unsigned int from = horizons[link.from];
+			const unsigned int to = horizons[link.to];
+			const int* out = &departures[link.from][link.fromPhase * from];
+			int* in = &predicted[link.to][link.toPhase * to];
+
+			// whole vehicles, the fractions carried on so that the link keeps its share
+			float carry = 0;
+			for (unsigned int t = 0; t < from && t + link.travelTime < to; t++) {
+				carry += out[t] * link.share;
+				int vehicles = (int)(carry + 1e-4f);
+				in[t + link.travelTime] += vehicles;
+				carry -= vehicles;
+			}
+		}
+
+		bool changed = false;
+		for (unsigned int i = 0; i < junctions && !changed; i++)
+			changed = predicted[i] != inflows[i];
+		return changed;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopNetworkStats CopNetwork<NPhases, Objective>::solve()
+	{
+		return solve(chrono::steady_clock::time_point::max());
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopNetworkStats CopNetwork<NPhases, Objective>::solve(chrono::steady_clock::time_point until)
+	{
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		deadline = until;
+		stats.iterations = 0;
+		stats.converged = stats.deadlineHit = false;
+
+		// the first round sees the junctions on their own
+		for (unsigned int i = 0; i < junctions; i++) {
+			fill(inflows[i].begin(), inflows[i].end(), 0);
+			arrivals[i] = locals[i];
+		}
+
+		NodeTask task(this);
+		while (junctions > 0) {
+			pool.run(task, junctions, 1);
+			stats.iterations++;
+
+			for (unsigned int i = 0; i < junctions; i++)
+				stats.deadlineHit = stats.deadlineHit || solvers[i].getSolveStats().deadlineHit;
+
+			if (!predict()) {
+				stats.converged = true;
+				break;
+			}
+			if (stats.iterations >= maxIterations)
+				break;
+			if (stats.deadlineHit || chrono::steady_clock::now() >= deadline) {
+				stats.deadlineHit = true;
+				break;
+			}
+
+			for (unsigned int i = 0; i < junctions; i++) {
+				inflows[i].swap(predicted[i]);
+				for (unsigned int k = 0; k < arrivals[i].size(); k++)
+					arrivals[i][k] = locals[i][k] + inflows[i][k];
+			}
+		}
+
+		stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopNetworkStats CopNetwork<NPhases, Objective>::getStats()
+	{
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> CopNetwork<NPhases, Objective>::getOptimalControl(unsigned int i)
+	{
+		return sequences[i];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopNetwork<NPhases, Objective>::getValue(unsigned int i)
+	{
+		return values[i];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<vector<int> > CopNetwork<NPhases, Objective>::getPredictedArrivals(unsigned int i)
+	{
+		// those the last solve of junction i saw
+		vector<vector<int> > out(horizons[i], vector<int>(NPhases));
+		for (unsigned int k = 0; k < horizons[i]; k++)
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				out[k][phi] = inflows[i][phi * horizons[i] + k];
+		return out;
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopNetwork<2, COP_QUEUES>;
+	template class CopNetwork<2, COP_STOPS>;
+	template class CopNetwork<2, COP_DELAY>;
+	template class CopNetwork<3, COP_QUEUES>;
+	template class CopNetwork<3, COP_STOPS>;
+	template class CopNetwork<3, COP_DELAY>;
+	template class CopNetwork<4, COP_QUEUES>;
+	template class CopNetwork<4, COP_STOPS>;
+	template class CopNetwork<4, COP_DELAY>;
+}
@@ -0,0 +1,128 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPNETWORK_API __declspec(dllexport)
+#else
+#define COPNETWORK_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPNETWORK
+#define FROST_ALGORITHMS_COPNETWORK
+
+#include "COP97A.h"
+#include <vector>
+#include <chrono>
+
+namespace COP97A {
+
+	/*
+	* Vehicles leaving phase fromPhase of junction from reach phase toPhase
+	* of junction to travelTime slots later; share of them take the link.
+	*/
+	struct CopLink
+	{
+		unsigned int from;
+		int fromPhase;
+		unsigned int to;
+		int toPhase;
+		unsigned int travelTime;
+		float share;
+
+		CopLink() : from(0), fromPhase(0), to(0), toPhase(0), travelTime(0), share(1.0f) {}
+		CopLink(unsigned int from, int fromPhase, unsigned int to, int toPhase, unsigned int travelTime, float share = 1.0f)
+			: from(from), fromPhase(fromPhase), to(to), toPhase(toPhase), travelTime(travelTime), share(share) {}
+	};
+
+	/*
+	* How the last network solve went
+	*/
+	struct CopNetworkStats
+	{
+		unsigned int iterations;	// rounds of junction solves
+		bool converged;				// the last round left every prediction as it was
+		bool deadlineHit;			// stopped by the deadline before converging
+		double seconds;
+	};
+
+	/*
+	* COP over a small network. Every junction is solved on its own arrivals
+	* plus those predicted from its upstream junctions: their optimal
+	* sequences are played on their own arrivals, the vehicles discharged per
+	* slot (Cop::getM of the green so far) are moved along the links by
+	* travel time, and the junctions are solved again until the predictions
+	* stop changing. Each round solves the junctions in parallel, one Cop per
+	* junction with warm start on, so later rounds only redo the states past
+	* the first changed slot.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopNetwork
+	{
+	public:
+		CopNetwork(unsigned int junctions, int threads = 1);
+		unsigned int size();
+		int getThreads();
+		void setJunction(unsigned int i, const CopJunction& junction);
+		CopJunction getJunction(unsigned int i);
+		void setArrivals(unsigned int i, const std::vector<std::vector<int> >& arrivals);	//[slot][phase] from its own detectors
+		void setDischargeProfile(unsigned int i, std::shared_ptr<CopDischargeProfile> profile);	//NULL = linear
+		int addLink(const CopLink& link);	//its index, -1 if a junction or phase is out of range
+		void clearLinks();
+		void setMaxIterations(unsigned int iterations);	//rounds per solve, 10 by default
+
+		CopNetworkStats solve();	//blocks until done
+		CopNetworkStats solve(std::chrono::steady_clock::time_point deadline);	//no round is started past it
+		CopNetworkStats getStats();
+		std::vector<int> getOptimalControl(unsigned int i);
+		int getValue(unsigned int i);
+		std::vector<std::vector<int> > getPredictedArrivals(unsigned int i);	//[slot][phase], from the links only
+
+	private:
+		// junctions [begin, end)
+		class NodeTask : public CopTask
+		{
+		public:
+			NodeTask(CopNetwork* network) : network(network) {}
+			void execute(unsigned int worker, unsigned int begin, unsigned int end);
+		private:
+			CopNetwork* network;
+		};
+
+		void solveNode(unsigned int i);
+		void discharge(unsigned int i);
+		bool predict();	//into predicted, true if it differs from inflows
+		inline int& local(unsigned int i, unsigned int phi, unsigned int k) { return locals[i][phi * horizons[i] + k]; }
+
+		unsigned int junctions;
+		int threads;
+		CopThreadPool pool;
+		std::vector<Cop<NPhases, Objective> > solvers;	// per junction
+		std::vector<unsigned int> solverHorizon;	// per junction, T of its Cop
+		std::vector<CopJunction> parameters;
+		std::vector<unsigned int> horizons;
+		std::vector<CopLink> links;
+		unsigned int maxIterations;
+		std::chrono::steady_clock::time_point deadline;
+
+		// per junction, one row per phase
+		std::vector<std::vector<int> > locals;		// own detectors
+		std::vector<std::vector<int> > inflows;		// predicted from the links
+		std::vector<std::vector<int> > predicted;	// inflows of the next round
+		std::vector<std::vector<int> > arrivals;	// locals + inflows, read in place by the solver
+		std::vector<std::vector<int> > departures;	// discharged by the last sequence
+		std::vector<std::vector<int> > greens;		// per slot, phase with right of way and slots into its green
+		std::vector<std::vector<int> > sequences;
+		std::vector<int> values;
+		CopNetworkStats stats;
+	};
+
+	// defined in CopNetwork.cpp
+	extern template class COPNETWORK_API CopNetwork<2, COP_QUEUES>;
+	extern template class COPNETWORK_API CopNetwork<2, COP_STOPS>;
+	extern template class COPNETWORK_API CopNetwork<2, COP_DELAY>;
+	extern template class COPNETWORK_API CopNetwork<3, COP_QUEUES>;
+	extern template class COPNETWORK_API CopNetwork<3, COP_STOPS>;
+	extern template class COPNETWORK_API CopNetwork<3, COP_DELAY>;
+	extern template class COPNETWORK_API CopNetwork<4, COP_QUEUES>;
+	extern template class COPNETWORK_API CopNetwork<4, COP_STOPS>;
+	extern template class COPNETWORK_API CopNetwork<4, COP_DELAY>;
+}
+
+#endif
@@ -0,0 +1,108 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPORIGINAL_API __declspec(dllexport) 
+#else
+#define COPORIGINAL_API  __declspec(dllimport) 
+#endif
+
+#ifndef FROST_ALGORITHMS_COPORIGINAL
+#define FROST_ALGORITHMS_COPORIGINAL
+
+// Compile Options:  /GX
+namespace std {
+#include <cstdlib>
+
+};	
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+//using namespace System;
+
+namespace COP97A {
+
+	/*
+	* The COP DP as it stood before Cop, kept verbatim so that
+	* CopDifferential times and checks the rewrite against it. Three phases
+	* and delay only; RunCOP writes to cout.
+	*/
+	class CopOriginal
+	{
+	public: 
+		//CopOriginal();
+		 COPORIGINAL_API CopOriginal(char*, int);	//load from file
+		 COPORIGINAL_API CopOriginal(std::vector<int>, int, int);	//load from vector
+		 COPORIGINAL_API CopOriginal(char*, int, int, int); //load from string
+		 COPORIGINAL_API CopOriginal(char*, int, int); //load from file with Horizon
+		 COPORIGINAL_API CopOriginal(std::vector<std::vector<int> >, int iphase, int horizon); // load from multiarray
+		 COPORIGINAL_API CopOriginal(int iphase, int horizon);
+		 COPORIGINAL_API std::vector<int> getFeasibleGreens(int, int);
+		 COPORIGINAL_API int getInitialPhase();
+		 COPORIGINAL_API  int getRed();
+		 COPORIGINAL_API int getQ(int, int, int);
+		 COPORIGINAL_API int getArrivals(int, int, int);
+		 COPORIGINAL_API int getB(int, int, int);
+		 COPORIGINAL_API int getM(int, int); 
+		 COPORIGINAL_API int getT(int, int); 
+		 COPORIGINAL_API std::vector<int> getOptimalControl(); 
+		 COPORIGINAL_API float getSaturationFlow(int); 
+		 COPORIGINAL_API void setSaturationFlow(int phi, float satFlow);
+		 COPORIGINAL_API void setStartupLostTime(float time);
+		 COPORIGINAL_API void setInitialPhase(int p);
+		 COPORIGINAL_API void setMinGreenTime(int mingreen);
+		 COPORIGINAL_API void setMaxGreenTime(int maxgreen);
+		 COPORIGINAL_API void setRedTime(int redd);
+		 COPORIGINAL_API void setLanePhases(int phi, int lanes);
+		 COPORIGINAL_API void setHorizon(int h);
+		 COPORIGINAL_API void setMaxPhCompute(int mp);
+		 COPORIGINAL_API void setArrivals(std::vector<std::vector<int> > arrivals);
+		 COPORIGINAL_API int getArrivalEarliest(int, int, int, int); //NEW
+
+		 COPORIGINAL_API void resizeArrivals();
+		 COPORIGINAL_API void initMatrices(int);
+		 COPORIGINAL_API void printVector(std::vector<int> );
+		 COPORIGINAL_API void printMatrix(std::vector<std::vector<int> > );
+		 COPORIGINAL_API std::vector<int> printSequence(int[], int);
+		 COPORIGINAL_API void printArrivals();
+
+		 COPORIGINAL_API std::vector<int> RunCOP();
+		 COPORIGINAL_API bool loadFromFile(char*);
+		 COPORIGINAL_API bool loadFromSeq(char*, unsigned int, int);
+		 COPORIGINAL_API bool loadFromVector(std::vector<int>, int);
+		 COPORIGINAL_API void initParameters();
+
+		 COPORIGINAL_API void setOutput(bool);
+
+	private:
+
+		enum PIEnum {
+			QUEUES, STOPS, DELAY
+		};
+		int PI;
+		int red;
+		int mingreen;
+		int maxgreen;
+		float startupLostTime; //time from total halt to free-flow (2 secs)
+		unsigned int T; //planning horizon
+		unsigned int M; //maximum number of phases to compute
+		int initialPhase; // = 2;								//-----------------> state rep
+		int idxCurrentPh; //= initialPhase; // set initial phase to C (2)
+		//float satHeadway; // avg headway between vehicles during saturated flow
+		//float satFlowRate; // = 0.0; No.Lanes / satHeadway
+		float satFlows[3]; //per phase
+		int lanePhases[3]; //per phase
+		bool output;
+		char phaseSeq[3]; // A, B, C
+		std::vector<int> phases; // A = 0, B = 1, C = 2
+		std::vector<int> optControlSequence; // A = 0, B = 1, C = 2
+		std::vector< std::vector<int> > arrivalData; //---------------------> state rep
+		std::vector< std::vector<int> > v; //v_j(s_j);
+		std::vector< std::vector<int> > x_star; // optimal solutions x*_j(s_j)
+		std::vector<std::vector<std::vector<int> > > Q; // permanent queue lengths Q_{phi, j}(s_j)
+		std::vector<std::vector<std::vector<int> > > L; // temporary queue lengths Q_{phi, j}(s_j, x_j)
+		std::vector<std::vector<std::vector<int> > > S; // temporary stopped  L_{sigma, j}(s_j, x_j)
+
+	};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+// Counters of a COP solve
+#include <iostream>
+#include "CopProfile.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	void CopProfile::clear()
+	{
+		seconds = 0;
+		states = candidates = 0;
+		for (int c = 0; c < COP_CALL_COUNT; c++)
+			calls[c] = 0;
+		bytesAllocated = workspaceBytes = 0;
+		stages.clear();
+	}
+
+	void CopProfile::writeJson(ostream& out) const
+	{
+		static const char* const callNames[COP_CALL_COUNT] = { "getArrivals", "getB", "getQ", "getM", "getT" };
+
+		out << "{\"enabled\":" << (enabled ? "true" : "false")
+			<< ",\"seconds\":" << seconds
+			<< ",\"states\":" << states
+			<< ",\"candidates\":" << candidates
+			<< ",\"calls\":{";
+		for (int c = 0; c < COP_CALL_COUNT; c++)
+			out << (c > 0 ? "," : "") << '"' << callNames[c] << "\":" << calls[c];
+		out << "},\"bytesAllocated\":" << bytesAllocated
+			<< ",\"workspaceBytes\":" << workspaceBytes
+			<< ",\"peakWorkspaceBytes\":" << peakWorkspaceBytes
+			<< ",\"stages\":[";
+		for (size_t n = 0; n < stages.size(); n++) {
+			const CopStageProfile& stage = stages[n];
+			out << (n > 0 ? "," : "") << "{\"stage\":" << stage.stage
+				<< ",\"seconds\":" << stage.seconds
+				<< ",\"states\":" << stage.states
+				<< ",\"candidates\":" << stage.candidates << '}';
+		}
+		out << "]}";
+	}
+}
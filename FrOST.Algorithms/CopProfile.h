@@ -0,0 +1,63 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPPROFILE_API __declspec(dllexport)
+#else
+#define COPPROFILE_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPPROFILE
+#define FROST_ALGORITHMS_COPPROFILE
+
+#include <vector>
+#include <iostream>
+#include <cstddef>
+
+// 0 compiles the solve counters out, Cop::getProfile then stays empty
+#ifndef COP_PROFILING
+#define COP_PROFILING 1
+#endif
+
+namespace COP97A {
+
+	// table lookups counted per solve, see CopProfile::calls
+	enum CopProfileCall {
+		COP_CALL_ARRIVALS,	// getArrivals
+		COP_CALL_B,			// getB
+		COP_CALL_Q,			// getQ
+		COP_CALL_M,			// getM
+		COP_CALL_T,			// getT
+		COP_CALL_COUNT
+	};
+
+	struct CopStageProfile
+	{
+		unsigned int stage;
+		double seconds;
+		unsigned int states;			// sj evaluated, reused warm states not counted
+		unsigned long long candidates;	// greens tried over those states
+	};
+
+	/*
+	* Where the last solve spent its time. Counters are kept per worker and
+	* summed once the solve ends, so they cost a branch and an add each. The
+	* vector kernels read the prefix tables directly, their candidates show
+	* up in candidates but not in calls.
+	*/
+	struct CopProfile
+	{
+		bool enabled;				// built with COP_PROFILING
+		double seconds;
+		unsigned long long states;
+		unsigned long long candidates;
+		unsigned long long calls[COP_CALL_COUNT];
+		size_t bytesAllocated;		// by workspace growth during the solve
+		size_t workspaceBytes;		// held by the tables after it
+		size_t peakWorkspaceBytes;	// most held since the solver was made
+		std::vector<CopStageProfile> stages;
+
+		CopProfile() : enabled(COP_PROFILING != 0), peakWorkspaceBytes(0) { clear(); }
+		COPPROFILE_API void clear();	// all but the peak, keeps the stage capacity
+		COPPROFILE_API void writeJson(std::ostream& out) const;
+	};
+}
+
+#endif
@@ -0,0 +1,241 @@
+// Brute force COP, to check the DP against
+#include <iostream>
+#include <algorithm>
+#include "CopReference.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopReference<NPhases, Objective>::CopReference()
+		: cop(0, 10), maxPaths(0), clamped(false), bestValue(0), paths(0), complete(true)
+	{
+		junction.horizon = 0;	// so that setJunction lays out the arrivals
+		setJunction(CopJunction());
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopReference<NPhases, Objective>::configure()
+	{
+		cop.configure(junction);
+		cop.setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopReference<NPhases, Objective>::setJunction(const CopJunction& option)
+	{
+		const bool relayout = option.horizon != junction.horizon;
+		junction = option;
+		configure();
+		if (relayout) {	// arrivals of another horizon are dropped
+			const unsigned int T = junction.horizon;
+			arrivals.assign(T * NPhases, 0);
+			cop.setHorizon(T);
+			if (T > 0)
+				cop.setArrivals(&arrivals[0], T);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopJunction CopReference<NPhases, Objective>::getJunction()
+	{
+		return junction;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopReference<NPhases, Objective>::setArrivals(const vector<vector<int> >& data)
+	{
+		// slots past the end of data are taken as empty
+		const unsigned int T = junction.horizon;
+		for (unsigned int k = 0; k < T; k++)
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				arrivals[k * NPhases + phi] = k < data.size() && phi < data[k].size() ? data[k][phi] : 0;
+		if (T > 0)
+			cop.setArrivals(&arrivals[0], T);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopReference<NPhases, Objective>::setDischargeProfile(shared_ptr<CopDischargeProfile> option)
+	{
+		profile = option;
+		cop.setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopReference<NPhases, Objective>::setMaxPaths(unsigned long long option)
+	{
+		maxPaths = option;
+	}
+
+	/*
+	* Stages 1 .. n of the path in states and greens, the terms as in
+	* Cop::evaluateGreen but every queue the one this path left behind
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopReference<NPhases, Objective>::score(unsigned int n)
+	{
+		int queues[NPhases] = {};
+		int value = 0;	// v_0
+		int current = cop.getInitialPhase();
+
+		for (unsigned int j = 1; j <= n; j++) {
+			const int si = j != 1 ? states[j - 1] : 0;
+			const int sj = states[j];
+			const int xj = greens[j];
+			int maxQueue = -1, stops = 0, delay = 0;
+
+			for (unsigned int p = 0; p < NPhases; p++) {
+				const int Q = queues[p];
+				if ((int)p != current) {
+					queues[p] = Q + cop.getArrivals(si, sj, p);
+					stops += cop.getArrivals(si, sj, p);
+					delay += Q * (sj - si) + cop.getB(si, sj, p);
+				}
+				else {
+					const int M = cop.getM(p, xj);
+					queues[p] = max(0, Q + cop.getArrivals(si, si + xj, p) - M)
+						+ cop.getArrivals(si + xj, sj, p);
+					stops += max(0, cop.getArrivals(si, si + xj, p) - max(0, M - Q))
+						+ cop.getArrivals(si + xj, sj, p);
+					delay += cop.getT(min(Q, M), p) + max(0, Q - M) * (sj - si)
+						+ cop.getB(cop.getArrivalEarliest(si, sj, xj, p), sj, p);
+				}
+				maxQueue = max(maxQueue, queues[p]);
+			}
+
+			if (Objective == COP_QUEUES)
+				value = max(maxQueue, value);
+			else if (Objective == COP_STOPS)
+				value += stops;
+			else
+				value += delay;
+			current = Cop<NPhases, Objective>::nextPhase(current);
+		}
+		return value;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopReference<NPhases, Objective>::evaluate(const vector<int>& sequence)
+	{
+		const unsigned int n = (unsigned int)sequence.size();
+		if (n == 0 || junction.horizon == 0)
+			return 0;
+
+		// backwards from T, clamped at red as Cop::recoverSequence does
+		states.assign(n + 1, 0);
+		greens.assign(n + 1, 0);
+		int s = (int)junction.horizon;
+		clamped = false;
+		for (unsigned int j = n; j >= 1; j--) {
+			states[j] = s;
+			greens[j] = sequence[j - 1];
+			if (j > 1) {
+				s -= greens[j] != 0 ? greens[j] + junction.red : 0;
+				if (s < junction.red)
+					clamped = true;
+				if (s <= junction.red)
+					s = junction.red;
+			}
+		}
+		return score(n);
+	}
+
+	/*
+	* Every green of stage j from state states[j], on to stage j - 1 from
+	* the state it leaves; stage 1 has the one green that reaches it from 0.
+	* So every sequence the DP can give is walked, as evaluate places it
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopReference<NPhases, Objective>::walk(unsigned int j)
+	{
+		vector<int>& set = candidates[j];
+		const int size = cop.getFeasibleGreens(states[j], j, &set[0]);
+
+		for (int c = 0; c < size && complete; c++) {
+			const int x = set[c];
+			greens[j] = x;
+
+			if (j == 1) {
+				if (maxPaths != 0 && paths >= maxPaths) {
+					complete = false;
+					return;
+				}
+				paths++;
+				int value = score((unsigned int)states.size() - 1);
+				if (best.empty() || value < bestValue) {
+					bestValue = value;
+					best.assign(greens.begin() + 1, greens.end());
+				}
+				continue;
+			}
+
+			// left below red, the DP reads index si and recoverSequence puts s_{j-1} at red
+			const int si = x != 0 ? states[j] - x - junction.red : states[j];
+			states[j - 1] = max(si, junction.red);
+			walk(j - 1);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopReference<NPhases, Objective>::solve(unsigned int n)
+	{
+		best.clear();
+		bestValue = 0;
+		paths = 0;
+		complete = true;
+		if (n == 0 || (int)junction.horizon < junction.red)
+			return 0;
+
+		states.assign(n + 1, 0);
+		greens.assign(n + 1, 0);
+		candidates.resize(n + 1);
+		for (unsigned int j = 1; j <= n; j++)
+			candidates[j].resize(2 + max(0, junction.maxgreen - junction.mingreen));
+
+		states[n] = (int)junction.horizon;
+		walk(n);
+		return (int)best.size();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	bool CopReference<NPhases, Objective>::isClamped()
+	{
+		return clamped;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopReference<NPhases, Objective>::getValue()
+	{
+		return bestValue;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> CopReference<NPhases, Objective>::getOptimalControl()
+	{
+		return best;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned long long CopReference<NPhases, Objective>::getPaths()
+	{
+		return paths;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	bool CopReference<NPhases, Objective>::isComplete()
+	{
+		return complete;
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopReference<2, COP_QUEUES>;
+	template class CopReference<2, COP_STOPS>;
+	template class CopReference<2, COP_DELAY>;
+	template class CopReference<3, COP_QUEUES>;
+	template class CopReference<3, COP_STOPS>;
+	template class CopReference<3, COP_DELAY>;
+	template class CopReference<4, COP_QUEUES>;
+	template class CopReference<4, COP_STOPS>;
+	template class CopReference<4, COP_DELAY>;
+}
@@ -0,0 +1,78 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPREFERENCE_API __declspec(dllexport)
+#else
+#define COPREFERENCE_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPREFERENCE
+#define FROST_ALGORITHMS_COPREFERENCE
+
+#include "COP97A.h"
+#include <vector>
+
+namespace COP97A {
+
+	/*
+	* Brute force COP for small horizons, to check the DP against. Every
+	* sequence of greens from Cop::getFeasibleGreens that the DP can give
+	* is walked backwards from s_n = T, a state left below red put at red as
+	* Cop::recoverSequence does, and scored with the terms of
+	* Cop::evaluateGreen (getArrivals, getB, getM, getT of a Cop on the same
+	* inputs) but with the queues this sequence itself left behind rather
+	* than those the DP tables hold. With red = 1 and no state put at red the
+	* value of a sequence is the one solve reports for it; otherwise getQ
+	* reads the queues of state si + red - 1, or none below red.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopReference
+	{
+	public:
+		CopReference();
+		void setJunction(const CopJunction& junction);
+		CopJunction getJunction();
+		void setArrivals(const std::vector<std::vector<int> >& arrivals);	//[slot][phase], as Cop::setArrivals
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//NULL = linear
+		void setMaxPaths(unsigned long long paths);	//walked per solve before giving up, 0 = no limit (default)
+
+		int evaluate(const std::vector<int>& sequence);	//states placed backwards from T as Cop::recoverSequence
+		bool isClamped();	//the last evaluate put a state that fell below red at red
+		int solve(unsigned int stages);	//best of exactly stages greens (0 = skip), gives the sequence length, 0 if none
+		int getValue();
+		std::vector<int> getOptimalControl();
+		unsigned long long getPaths();	//walked by the last solve
+		bool isComplete();	//the last solve walked every path
+
+	private:
+		void configure();
+		int score(unsigned int n);	//path in states / greens, stages 1 .. n
+		void walk(unsigned int j);
+
+		Cop<NPhases, Objective> cop;	// terms only, never solved
+		CopJunction junction;
+		std::shared_ptr<CopDischargeProfile> profile;
+		std::vector<int> arrivals;	// [slot * NPhases + phase]
+		unsigned long long maxPaths;
+		bool clamped;
+
+		std::vector<int> states;	// s_j, s_0 = 0
+		std::vector<int> greens;	// x_j, [0] unused
+		std::vector<std::vector<int> > candidates;	// per stage, feasible greens
+		std::vector<int> best;
+		int bestValue;
+		unsigned long long paths;
+		bool complete;
+	};
+
+	// defined in CopReference.cpp
+	extern template class COPREFERENCE_API CopReference<2, COP_QUEUES>;
+	extern template class COPREFERENCE_API CopReference<2, COP_STOPS>;
+	extern template class COPREFERENCE_API CopReference<2, COP_DELAY>;
+	extern template class COPREFERENCE_API CopReference<3, COP_QUEUES>;
+	extern template class COPREFERENCE_API CopReference<3, COP_STOPS>;
+	extern template class COPREFERENCE_API CopReference<3, COP_DELAY>;
+	extern template class COPREFERENCE_API CopReference<4, COP_QUEUES>;
+	extern template class COPREFERENCE_API CopReference<4, COP_STOPS>;
+	extern template class COPREFERENCE_API CopReference<4, COP_DELAY>;
+}
+
+#endif
@@ -0,0 +1,122 @@
+// LRU cache of COP results
+#include <iostream>
+#include <algorithm>
+#include "CopResultCache.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	CopResultCache::CopResultCache(size_t limit)
+		: maxBytes(limit), bytes(0), hits(0), misses(0), evictions(0)
+	{
+	}
+
+	void CopResultCache::setMaxBytes(size_t limit)
+	{
+		lock_guard<mutex> guard(lock);
+		maxBytes = limit;
+		evict(maxBytes);
+	}
+
+	uint64_t CopResultCache::hash(const vector<int>& key)
+	{
+		// FNV-1a over whole ints, mixed at the end so that close keys spread
+		uint64_t h = 14695981039346656037ULL;
+		for (size_t i = 0; i < key.size(); i++) {
+			h ^= (uint32_t)key[i];
+			h *= 1099511628211ULL;
+		}
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return h;
+	}
+
+	bool CopResultCache::find(const vector<int>& key, CopResult& out, int& endPhase)
+	{
+		uint64_t h = hash(key);
+
+		lock_guard<mutex> guard(lock);
+		unordered_map<uint64_t, EntryList::iterator>::iterator it = index.find(h);
+		if (it == index.end() || it->second->key != key) {
+			misses++;
+			return false;
+		}
+
+		entries.splice(entries.begin(), entries, it->second);	// now most recent
+		const Entry& entry = entries.front();
+		out.sequence.assign(entry.result.sequence.begin(), entry.result.sequence.end());
+		out.queues.assign(entry.result.queues.begin(), entry.result.queues.end());
+		out.value = entry.result.value;
+		out.stats = entry.result.stats;
+		endPhase = entry.endPhase;
+		hits++;
+		return true;
+	}
+
+	void CopResultCache::insert(const vector<int>& key, const CopResult& result, int endPhase)
+	{
+		size_t size = sizeof(Entry) + 4 * sizeof(void*)	// list node and index slot
+			+ (key.size() + result.sequence.size() + result.queues.size()) * sizeof(int);
+
+		uint64_t h = hash(key);
+
+		lock_guard<mutex> guard(lock);
+		if (size > maxBytes)
+			return;
+
+		unordered_map<uint64_t, EntryList::iterator>::iterator it = index.find(h);
+		if (it != index.end()) {	// same key solved again, or a collision: keep the newer
+			bytes -= it->second->bytes;
+			entries.erase(it->second);
+			index.erase(it);
+		}
+
+		evict(maxBytes - size);
+
+		entries.push_front(Entry());
+		Entry& entry = entries.front();
+		entry.hash = h;
+		entry.key = key;
+		entry.result.sequence = result.sequence;
+		entry.result.queues = result.queues;
+		entry.result.value = result.value;
+		entry.result.stats = result.stats;
+		entry.endPhase = endPhase;
+		entry.bytes = size;
+		index[h] = entries.begin();
+		bytes += size;
+	}
+
+	void CopResultCache::evict(size_t limit)
+	{
+		while (bytes > limit && !entries.empty()) {
+			bytes -= entries.back().bytes;
+			index.erase(entries.back().hash);
+			entries.pop_back();
+			evictions++;
+		}
+	}
+
+	void CopResultCache::clear()
+	{
+		lock_guard<mutex> guard(lock);
+		entries.clear();
+		index.clear();
+		bytes = 0;
+	}
+
+	CopCacheStats CopResultCache::getStats()
+	{
+		lock_guard<mutex> guard(lock);
+		CopCacheStats stats;
+		stats.hits = hits;
+		stats.misses = misses;
+		stats.evictions = evictions;
+		stats.entries = entries.size();
+		stats.bytes = bytes;
+		stats.maxBytes = maxBytes;
+		return stats;
+	}
+}
@@ -0,0 +1,70 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPRESULTCACHE_API __declspec(dllexport)
+#else
+#define COPRESULTCACHE_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPRESULTCACHE
+#define FROST_ALGORITHMS_COPRESULTCACHE
+
+#include "COP97A.h"
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+namespace COP97A {
+
+	struct CopCacheStats
+	{
+		unsigned long long hits;
+		unsigned long long misses;
+		unsigned long long evictions;
+		size_t entries;
+		size_t bytes;			// estimate of what the entries hold
+		size_t maxBytes;
+	};
+
+	/*
+	* Least recently used results of full solves, keyed by everything a solve
+	* depends on (see Cop::solve). A hit is confirmed against the stored key,
+	* so a hash collision costs a miss and never a wrong result. Safe to share
+	* between solvers of different threads.
+	*/
+	class CopResultCache
+	{
+	public:
+		COPRESULTCACHE_API CopResultCache(size_t maxBytes);
+		COPRESULTCACHE_API void setMaxBytes(size_t maxBytes);	//evicts down to it
+		COPRESULTCACHE_API bool find(const std::vector<int>& key, CopResult& out, int& endPhase);
+		COPRESULTCACHE_API void insert(const std::vector<int>& key, const CopResult& result, int endPhase);
+		COPRESULTCACHE_API void clear();
+		COPRESULTCACHE_API CopCacheStats getStats();
+		COPRESULTCACHE_API static uint64_t hash(const std::vector<int>& key);
+
+	private:
+		CopResultCache(const CopResultCache&);
+		CopResultCache& operator=(const CopResultCache&);
+
+		struct Entry
+		{
+			uint64_t hash;
+			std::vector<int> key;
+			CopResult result;
+			int endPhase;	// phase with right-of-way after the solve
+			size_t bytes;
+		};
+		typedef std::list<Entry> EntryList;
+
+		void evict(size_t limit);
+
+		EntryList entries;	// most recently used first
+		std::unordered_map<uint64_t, EntryList::iterator> index;
+		size_t maxBytes;
+		size_t bytes;
+		unsigned long long hits, misses, evictions;
+		std::mutex lock;
+	};
+}
+
+#endif
@@ -0,0 +1,462 @@
+// COP over arrival scenarios
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <random>
+#include "CopScenarioSolver.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopScenarioSolver<NPhases, Objective>::CopScenarioSolver(unsigned int n, int nThreads)
+		: scenarios(n), threads(nThreads < 1 ? 1 : nThreads), pool(nThreads < 1 ? 1 : nThreads),
+		riskMeasure(COP_EXPECTED), alpha(0.9f), slots(0), indexStale(true), seed(0), chosen(0)
+	{
+		for (unsigned int w = 0; w < pool.size(); w++)
+			solvers.push_back(Cop<NPhases, Objective>(0, 10));	// serial, the scenarios are split
+		states.resize(pool.size());
+		scratch.assign(pool.size() * (NPhases + 4) * n, 0);
+		zeros.assign(n, 0);
+		setJunction(CopJunction());
+
+		stats.scenarios = n;
+		stats.candidates = stats.chosen = 0;
+		stats.expected = stats.cvar = stats.seconds = 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int CopScenarioSolver<NPhases, Objective>::size()
+	{
+		return scenarios;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopScenarioSolver<NPhases, Objective>::getThreads()
+	{
+		return threads;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::configure(Cop<NPhases, Objective>& cop)
+	{
+		cop.configure(junction);
+		cop.setHorizon(slots);
+		cop.setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::setJunction(const CopJunction& j)
+	{
+		if (j.horizon != slots) {	// scenarios of another horizon are dropped
+			slots = j.horizon;
+			arrivals.assign(NPhases * slots * scenarios, 0);
+			indexStale = true;
+		}
+		junction = j;
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			configure(solvers[w]);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopJunction CopScenarioSolver<NPhases, Objective>::getJunction()
+	{
+		return junction;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::setDischargeProfile(shared_ptr<CopDischargeProfile> option)
+	{
+		profile = option;
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			solvers[w].setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::setRiskMeasure(CopRiskMeasure measure, float level)
+	{
+		riskMeasure = measure;
+		alpha = level;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::setScenario(unsigned int k, const vector<vector<int> >& data)
+	{
+		// slots past the end of data are taken as empty
+		for (unsigned int s = 0; s < slots; s++)
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				arrival(phi, s, k) = s < data.size() && phi < data[s].size() ? data[s][phi] : 0;
+		indexStale = true;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::sampleScenarios(const vector<vector<int> >& data, const vector<vector<float> >& turns, unsigned int first)
+	{
+		counts.assign(slots * NPhases, 0);
+		for (unsigned int s = 0; s < slots && s < data.size(); s++)
+			for (unsigned int phi = 0; phi < NPhases && phi < data[s].size(); phi++)
+				counts[s * NPhases + phi] = data[s][phi];
+
+		// cumulative rows, a vehicle left over by a row short of 1 stays on its phase
+		split.assign(NPhases * NPhases, 0.0f);
+		for (unsigned int p = 0; p < NPhases; p++) {
+			float sum = 0;
+			for (unsigned int q = 0; q < NPhases; q++) {
+				sum += p < turns.size() && q < turns[p].size() ? turns[p][q] : 0.0f;
+				split[p * NPhases + q] = sum;
+			}
+		}
+		seed = first;
+
+		ScenarioTask task(this, ScenarioTask::SAMPLE);
+		pool.run(task, scenarios);
+		indexStale = true;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::sampleScenario(unsigned int k)
+	{
+		mt19937 random(seed + k);
+		for (unsigned int s = 0; s < slots; s++) {
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				arrival(phi, s, k) = 0;
+
+			for (unsigned int p = 0; p < NPhases; p++) {
+				for (int n = 0; n < counts[s * NPhases + p]; n++) {
+					float u = uniformDraw(random);
+					unsigned int q = 0;
+					while (q < NPhases && u >= split[p * NPhases + q])
+						q++;
+					arrival(q < NPhases ? q : p, s, k)++;
+				}
+			}
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::buildIndex()
+	{
+		// as Cop::buildArrivalIndex, for all scenarios per row
+		unsigned int K = scenarios;
+		cumArrivals.assign(NPhases * (slots + 1) * K, 0);
+		cumRequests.assign(NPhases * (slots + 1) * K, 0);
+		cumRequestTimes.assign(NPhases * (slots + 1) * K, 0);
+		meanArrivals.assign(slots * NPhases, 0);
+
+		for (unsigned int p = 0; p < NPhases; p++) {
+			for (unsigned int s = 0; s < slots; s++) {
+				const int* a = &arrival(p, s, 0);
+				const unsigned int row = (p * (slots + 1) + s) * K;
+				int* C = &cumArrivals[row];
+				int* N = &cumRequests[row];
+				int* W = &cumRequestTimes[row];
+				long long sum = 0;
+				for (unsigned int k = 0; k < K; k++) {
+					C[K + k] = C[k] + a[k];
+					N[K + k] = N[k] + (a[k] != 0 ? 1 : 0);
+					W[K + k] = W[k] + (a[k] != 0 ? s : 0);
+					sum += a[k];
+				}
+				meanArrivals[s * NPhases + p] = K > 0 ? (int)((sum + K / 2) / K) : 0;
+			}
+		}
+		indexStale = false;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::buildDischargeTables()
+	{
+		// Cop's own tables, over the greens and the most vehicles of any scenario
+		Cop<NPhases, Objective>& cop = solvers[0];
+		unsigned int greens = max(junction.mingreen, min(junction.maxgreen, (int)slots)) + 1;
+		discharged.resize(NPhases);
+		dischargeTimes.resize(NPhases);
+
+		for (unsigned int p = 0; p < NPhases; p++) {
+			int most = 0;
+			discharged[p].resize(greens);
+			for (unsigned int x = 0; x < greens; x++) {
+				discharged[p][x] = cop.getM(p, x);
+				most = max(most, discharged[p][x]);
+			}
+
+			// queues hold each arrival once, stage 1 may count one slot twice (see Cop::getArrivals)
+			const int* total = cumRow(cumArrivals, p, slots);
+			int queued = 0;
+			for (unsigned int k = 0; k < scenarios; k++)
+				queued = max(queued, 2 * total[k]);
+
+			dischargeTimes[p].resize(min(most, queued) + 1);
+			for (unsigned int d = 0; d < dischargeTimes[p].size(); d++)
+				dischargeTimes[p][d] = cop.getT(d, p);
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::ScenarioTask::execute(unsigned int worker, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++) {
+			if (kind == SAMPLE)
+				solver->sampleScenario(i);
+			else if (kind == SOLVE)
+				solver->solveCandidate(worker, i);
+			else {
+				int* row = &solver->values[i * solver->scenarios];
+				solver->play(worker, solver->candidates[solver->distinct[i]], row);
+				solver->measure(worker, row, solver->expected[i], solver->cvar[i]);
+			}
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::solveCandidate(unsigned int worker, unsigned int c)
+	{
+		Cop<NPhases, Objective>& cop = solvers[worker];
+		cop.setInitialPhase(junction.initialPhase);	// a solve moves it on
+		if (c == 0)
+			cop.setArrivals(&meanArrivals[0], slots);
+		else	// in place, scenario c - 1 of every row
+			cop.setArrivals(&arrival(0, 0, c - 1), slots, scenarios, slots * scenarios);
+
+		cop.solve();
+		const CopResult& result = cop.getResult();
+		candidates[c].assign(result.sequence.begin(), result.sequence.end());
+	}
+
+	/*
+	* Plays the sequence in every scenario with the terms of
+	* Cop::evaluateGreen; stage j ends at the state recoverSequence gives it.
+	* Queues are carried along the played stages, so with red = 1 a sequence
+	* solved for scenario k is worth its v_j(T) there. getQ reads the queues
+	* red - 1 states on, hence with longer reds the two may differ, and the
+	* selection is by the played value, not the DP's (see the class comment).
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::play(unsigned int worker, const vector<int>& sequence, int* v)
+	{
+		const unsigned int K = scenarios;
+		const int red = junction.red;
+		const int n = (int)sequence.size();
+
+		vector<int>& s = states[worker];
+		s.resize(n + 1);
+		s[n] = slots;
+		for (int j = n; j > 1; j--) {
+			int x = sequence[j - 1];
+			s[j - 1] = s[j] - (x != 0 ? x + red : 0);
+			if (s[j - 1] <= red)
+				s[j - 1] = red;
+		}
+
+		int* Q = &scratch[worker * (NPhases + 4) * K];
+		int* maxQ = Q + NPhases * K;
+		int* stops = maxQ + K;
+		int* delay = stops + K;
+		fill(Q, Q + NPhases * K, 0);
+		fill(v, v + K, 0);
+
+		int current = junction.initialPhase;
+		for (int j = 1; j <= n; j++, current = Cop<NPhases, Objective>::nextPhase(current)) {
+			const int x = sequence[j - 1];
+			const int sj = s[j];
+			const int si = j == 1 ? 0 : sj - (x != 0 ? x + red : 0);
+			const int tp = si + x;	// end of the green
+			const int span = sj - si;
+
+			if (si == 0)	// initial queues are zero
+				fill(Q, Q + NPhases * K, 0);
+			fill(maxQ, maxQ + K, -1);
+			fill(stops, stops + K, 0);
+			fill(delay, delay + K, 0);
+
+			for (unsigned int p = 0; p < NPhases; p++) {
+				int* q = Q + p * K;
+				if (p != (unsigned int)current) {
+					const int *aHi, *aLo, *nHi, *nLo, *wHi, *wLo;
+					arrivalRows(p, si, sj, aHi, aLo);
+					requestRows(p, si, sj, nHi, nLo, wHi, wLo);
+					for (unsigned int k = 0; k < K; k++) {
+						int a = aHi[k] - aLo[k];
+						int tQueue = q[k] + a;
+						if (Objective == COP_STOPS)
+							stops[k] += a;
+						if (Objective == COP_DELAY)
+							delay[k] += q[k] * span + (nHi[k] - nLo[k]) * sj - (wHi[k] - wLo[k]);
+						maxQ[k] = max(maxQ[k], tQueue);
+						q[k] = tQueue;
+					}
+				}
+				else {
+					const int *a1Hi, *a1Lo, *a2Hi, *a2Lo, *nHi, *nLo, *wHi, *wLo;
+					arrivalRows(p, si, tp, a1Hi, a1Lo);
+					arrivalRows(p, tp, sj, a2Hi, a2Lo);
+					requestRows(p, tp, sj, nHi, nLo, wHi, wLo);
+					const int m = (unsigned int)x < discharged[p].size() ? discharged[p][x] : solvers[worker].getM(p, x);
+					const int* times = &dischargeTimes[p][0];
+					const int last = (int)dischargeTimes[p].size() - 1;
+					for (unsigned int k = 0; k < K; k++) {
+						int a1 = a1Hi[k] - a1Lo[k];
+						int a2 = a2Hi[k] - a2Lo[k];
+						int tQueue = max(0, q[k] + a1 - m) + a2;
+						if (Objective == COP_STOPS)
+							stops[k] += max(0, a1 - max(0, m - q[k])) + a2;
+						if (Objective == COP_DELAY)
+							delay[k] += times[min(min(q[k], m), last)] + max(0, q[k] - m) * span
+								+ (nHi[k] - nLo[k]) * sj - (wHi[k] - wLo[k]);
+						maxQ[k] = max(maxQ[k], tQueue);
+						q[k] = tQueue;
+					}
+				}
+			}
+
+			for (unsigned int k = 0; k < K; k++) {
+				if (Objective == COP_QUEUES)
+					v[k] = max(v[k], maxQ[k]);
+				else if (Objective == COP_STOPS)
+					v[k] += stops[k];
+				else
+					v[k] += delay[k];
+			}
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::arrivalRows(unsigned int p, int a, int b, const int*& hi, const int*& lo)
+	{
+		// arrivals in [a, b) are hi[k] - lo[k], a > b counts slot a as Cop::getArrivals does
+		if (a < b) {
+			hi = cumRow(cumArrivals, p, b);
+			lo = cumRow(cumArrivals, p, a);
+		}
+		else {
+			hi = a > b && a < (int)slots ? &arrival(p, a, 0) : &zeros[0];
+			lo = &zeros[0];
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::requestRows(unsigned int p, int a, int b, const int*& nHi, const int*& nLo, const int*& wHi, const int*& wLo)
+	{
+		// getB(a, b) is (nHi - nLo) * b - (wHi - wLo), 0 for a >= b
+		if (a < b) {
+			nHi = cumRow(cumRequests, p, b);
+			nLo = cumRow(cumRequests, p, a);
+			wHi = cumRow(cumRequestTimes, p, b);
+			wLo = cumRow(cumRequestTimes, p, a);
+		}
+		else
+			nHi = nLo = wHi = wLo = &zeros[0];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopScenarioSolver<NPhases, Objective>::measure(unsigned int worker, const int* v, double& mean, double& tail)
+	{
+		const unsigned int K = scenarios;
+		long long sum = 0;
+		for (unsigned int k = 0; k < K; k++)
+			sum += v[k];
+		mean = (double)sum / K;
+
+		// worst ceil((1 - alpha) K), at least one
+		unsigned int n = (unsigned int)ceil((1.0 - alpha) * K - 1e-9);
+		n = max(1u, min(K, n));
+		int* worst = &scratch[worker * (NPhases + 4) * K + (NPhases + 3) * K];
+		copy(v, v + K, worst);
+		nth_element(worst, worst + (n - 1), worst + K, greater<int>());
+		sum = 0;
+		for (unsigned int k = 0; k < n; k++)
+			sum += worst[k];
+		tail = (double)sum / n;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopScenarioStats CopScenarioSolver<NPhases, Objective>::solve()
+	{
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		if (scenarios == 0)
+			return stats;
+
+		if (indexStale)
+			buildIndex();
+		buildDischargeTables();
+
+		// candidates: the sequence of the mean arrivals and of every scenario
+		candidates.resize(scenarios + 1);
+		ScenarioTask solves(this, ScenarioTask::SOLVE);
+		pool.run(solves, scenarios + 1, 1);
+
+		map<vector<int>, int> seen;
+		distinct.clear();
+		for (unsigned int c = 0; c < candidates.size(); c++)
+			if (seen.insert(make_pair(candidates[c], c)).second)
+				distinct.push_back(c);
+
+		values.resize(distinct.size() * scenarios);
+		expected.resize(distinct.size());
+		cvar.resize(distinct.size());
+		ScenarioTask plays(this, ScenarioTask::PLAY);
+		pool.run(plays, (unsigned int)distinct.size(), 1);
+
+		// least measure, ties to the earlier candidate
+		const vector<double>& by = riskMeasure == COP_CVAR ? cvar : expected;
+		chosen = 0;
+		for (unsigned int i = 1; i < distinct.size(); i++)
+			if (by[i] < by[chosen])
+				chosen = i;
+
+		stats.scenarios = scenarios;
+		stats.candidates = (unsigned int)distinct.size();
+		stats.chosen = distinct[chosen];
+		stats.expected = expected[chosen];
+		stats.cvar = cvar[chosen];
+		stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopScenarioStats CopScenarioSolver<NPhases, Objective>::getStats()
+	{
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> CopScenarioSolver<NPhases, Objective>::getOptimalControl()
+	{
+		if (distinct.empty())
+			return vector<int>();
+		return candidates[distinct[chosen]];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopScenarioSolver<NPhases, Objective>::getValue(unsigned int k)
+	{
+		return values[chosen * scenarios + k];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	vector<int> CopScenarioSolver<NPhases, Objective>::evaluate(const vector<int>& sequence)
+	{
+		if (indexStale)
+			buildIndex();
+		buildDischargeTables();
+
+		vector<int> out(scenarios);
+		if (scenarios > 0)
+			play(0, sequence, &out[0]);
+		return out;
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopScenarioSolver<2, COP_QUEUES>;
+	template class CopScenarioSolver<2, COP_STOPS>;
+	template class CopScenarioSolver<2, COP_DELAY>;
+	template class CopScenarioSolver<3, COP_QUEUES>;
+	template class CopScenarioSolver<3, COP_STOPS>;
+	template class CopScenarioSolver<3, COP_DELAY>;
+	template class CopScenarioSolver<4, COP_QUEUES>;
+	template class CopScenarioSolver<4, COP_STOPS>;
+	template class CopScenarioSolver<4, COP_DELAY>;
+}
@@ -0,0 +1,138 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPSCENARIOSOLVER_API __declspec(dllexport)
+#else
+#define COPSCENARIOSOLVER_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPSCENARIOSOLVER
+#define FROST_ALGORITHMS_COPSCENARIOSOLVER
+
+#include "COP97A.h"
+#include <vector>
+
+namespace COP97A {
+
+	enum CopRiskMeasure {
+		COP_EXPECTED,	// mean over the scenarios
+		COP_CVAR		// mean over the worst 1 - alpha of them
+	};
+
+	/*
+	* How the last stochastic solve went, measures of the chosen sequence
+	*/
+	struct CopScenarioStats
+	{
+		unsigned int scenarios;
+		unsigned int candidates;	// distinct sequences evaluated
+		unsigned int chosen;		// 0 = that of the mean arrivals, k + 1 = that of scenario k
+		double expected;
+		double cvar;
+		double seconds;
+	};
+
+	/*
+	* COP for an uncertain arrival horizon. Every scenario, and the mean of
+	* them, is solved on its own; each of those sequences is then played
+	* against every scenario and the one with the least expected value, or
+	* CVaR, wins. Scenarios sit one array per phase and slot across k, so
+	* that playing a sequence is one pass over contiguous rows for all of
+	* them. Solves and plays are spread over the pool.
+	*
+	* Plays carry the queues along the sequence, while the DP reads them red - 1
+	* states on (Cop::getQ). With red > 1 a candidate may so play worse in its
+	* own scenario than the value its solve reported, and the choice can
+	* disagree with the one the DP's terms would make. With red = 1 they agree.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopScenarioSolver
+	{
+	public:
+		CopScenarioSolver(unsigned int scenarios, int threads = 1);
+		unsigned int size();
+		int getThreads();
+		void setJunction(const CopJunction& junction);
+		CopJunction getJunction();
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//NULL = linear
+		void setRiskMeasure(CopRiskMeasure measure, float alpha = 0.9f);
+		void setScenario(unsigned int k, const std::vector<std::vector<int> >& arrivals);	//[slot][phase], as Cop::setArrivals
+		// every vehicle counted on phase p turns to q with probability split[p][q], e.g.
+		// left turners of a shared detector; scenario k draws from seed + k
+		void sampleScenarios(const std::vector<std::vector<int> >& counts, const std::vector<std::vector<float> >& split, unsigned int seed);
+
+		CopScenarioStats solve();	//blocks until done
+		CopScenarioStats getStats();
+		std::vector<int> getOptimalControl();
+		int getValue(unsigned int k);	//of the chosen sequence in scenario k
+		std::vector<int> evaluate(const std::vector<int>& sequence);	//value in every scenario, greens from the initial phase
+
+	private:
+		class ScenarioTask : public CopTask
+		{
+		public:
+			enum Kind { SAMPLE, SOLVE, PLAY };
+			ScenarioTask(CopScenarioSolver* solver, Kind kind) : solver(solver), kind(kind) {}
+			void execute(unsigned int worker, unsigned int begin, unsigned int end);
+		private:
+			CopScenarioSolver* solver;
+			Kind kind;
+		};
+
+		void sampleScenario(unsigned int k);
+		void solveCandidate(unsigned int worker, unsigned int c);
+		void play(unsigned int worker, const std::vector<int>& sequence, int* values);
+		void buildIndex();
+		void buildDischargeTables();
+		void measure(unsigned int worker, const int* values, double& expected, double& cvar);
+		void configure(Cop<NPhases, Objective>& cop);
+		void arrivalRows(unsigned int phi, int a, int b, const int*& hi, const int*& lo);
+		void requestRows(unsigned int phi, int a, int b, const int*& nHi, const int*& nLo, const int*& wHi, const int*& wLo);
+		inline int& arrival(unsigned int phi, unsigned int s, unsigned int k) { return arrivals[(phi * slots + s) * scenarios + k]; }
+		// row over k of a prefix table at slot s
+		inline const int* cumRow(const std::vector<int>& table, unsigned int phi, unsigned int s) { return &table[(phi * (slots + 1) + s) * scenarios]; }
+
+		unsigned int scenarios;
+		int threads;
+		CopThreadPool pool;
+		std::vector<Cop<NPhases, Objective> > solvers;	// per worker
+		CopJunction junction;
+		std::shared_ptr<CopDischargeProfile> profile;
+		CopRiskMeasure riskMeasure;
+		float alpha;
+
+		unsigned int slots;				// horizon
+		std::vector<int> arrivals;		// see arrival()
+		std::vector<int> meanArrivals;	// [slot * NPhases + phase]
+		std::vector<int> cumArrivals, cumRequests, cumRequestTimes;	// see cumRow(), as Cop::buildArrivalIndex
+		bool indexStale;
+
+		std::vector<int> counts;		// sampleScenarios input, [slot * NPhases + phase]
+		std::vector<float> split;		// [p * NPhases + q], cumulative over q
+		unsigned int seed;
+
+		std::vector<std::vector<int> > discharged;	// per phase, Cop::getM by green
+		std::vector<std::vector<int> > dischargeTimes;	// per phase, Cop::getT by vehicles
+
+		std::vector<std::vector<int> > candidates;	// by solve: mean arrivals, then scenario k
+		std::vector<int> distinct;		// candidates played, first of equal ones
+		std::vector<int> values;		// [i * scenarios + k] for distinct[i]
+		std::vector<double> expected, cvar;	// per distinct
+		std::vector<int> scratch;		// per worker, queues and stage sums over k
+		std::vector<std::vector<int> > states;	// per worker, end state of each stage
+		std::vector<int> zeros;			// one row over k
+		unsigned int chosen;
+		CopScenarioStats stats;
+	};
+
+	// defined in CopScenarioSolver.cpp
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<2, COP_QUEUES>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<2, COP_STOPS>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<2, COP_DELAY>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<3, COP_QUEUES>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<3, COP_STOPS>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<3, COP_DELAY>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<4, COP_QUEUES>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<4, COP_STOPS>;
+	extern template class COPSCENARIOSOLVER_API CopScenarioSolver<4, COP_DELAY>;
+}
+
+#endif
@@ -0,0 +1,296 @@
+// Calibration sweeps of COP parameters
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include "CopSweep.h"
+
+using namespace std;
+
+namespace COP97A{
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopSweep<NPhases, Objective>::CopSweep(int nThreads)
+		: threads(nThreads < 1 ? 1 : nThreads), pool(nThreads < 1 ? 1 : nThreads), slotStride(0)
+	{
+		for (unsigned int w = 0; w < pool.size(); w++)
+			solvers.push_back(Cop<NPhases, Objective>(0, 10));	// serial, the sweep is split by job
+		solverHorizon.assign(pool.size(), 10);
+		expand();
+
+		stats.configurations = 1;
+		stats.traces = 0;
+		stats.seconds = stats.solvesPerSecond = 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	int CopSweep<NPhases, Objective>::getThreads()
+	{
+		return threads;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::setBase(const CopJunction& junction)
+	{
+		base = junction;
+		expand();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::setGrid(const CopSweepGrid& option)
+	{
+		grid = option;
+		expand();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::expand()
+	{
+		// sizes of the lists, an empty one counts once as the base value
+		const unsigned int radix[6] = {
+			max(1u, (unsigned int)grid.reds.size()), max(1u, (unsigned int)grid.mingreens.size()),
+			max(1u, (unsigned int)grid.maxgreens.size()), max(1u, (unsigned int)grid.satFlows.size()),
+			max(1u, (unsigned int)grid.horizons.size()), max(1u, (unsigned int)grid.maxPhases.size()) };
+		unsigned int n = 1;
+		for (int i = 0; i < 6; i++)
+			n *= radix[i];
+
+		configurations.assign(n, base);
+		for (unsigned int c = 0; c < n; c++) {
+			CopJunction& junction = configurations[c];
+			unsigned int digit[6];
+			for (int i = 5, rest = c; i >= 0; i--) {
+				digit[i] = rest % radix[i];
+				rest /= radix[i];
+			}
+			if (!grid.reds.empty())
+				junction.red = grid.reds[digit[0]];
+			if (!grid.mingreens.empty())
+				junction.mingreen = grid.mingreens[digit[1]];
+			if (!grid.maxgreens.empty())
+				junction.maxgreen = grid.maxgreens[digit[2]];
+			if (!grid.satFlows.empty())
+				for (unsigned int phi = 0; phi < NPhases; phi++)
+					junction.satFlows[phi] = grid.satFlows[digit[3]];
+			if (!grid.horizons.empty())
+				junction.horizon = grid.horizons[digit[4]];
+			if (!grid.maxPhases.empty())
+				junction.maxPhases = grid.maxPhases[digit[5]];
+		}
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::setDischargeProfile(shared_ptr<CopDischargeProfile> profile)
+	{
+		for (unsigned int w = 0; w < solvers.size(); w++)
+			solvers[w].setDischargeProfile(profile);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int CopSweep<NPhases, Objective>::addTrace(const vector<vector<int> >& data)
+	{
+		traces.push_back(vector<int>(data.size() * NPhases, 0));
+		vector<int>& trace = traces.back();
+		for (unsigned int k = 0; k < data.size(); k++)
+			for (unsigned int phi = 0; phi < NPhases && phi < data[k].size(); phi++)
+				trace[k * NPhases + phi] = data[k][phi];
+		traceSlots.push_back((unsigned int)data.size());
+		slotStride = 0;	// laid out again by the next run
+		return (unsigned int)traces.size() - 1;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::clearTraces()
+	{
+		traces.clear();
+		traceSlots.clear();
+		traceData.clear();
+		slotStride = 0;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int CopSweep<NPhases, Objective>::getConfigurations()
+	{
+		return (unsigned int)configurations.size();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	unsigned int CopSweep<NPhases, Objective>::getTraces()
+	{
+		return (unsigned int)traces.size();
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopJunction CopSweep<NPhases, Objective>::getConfiguration(unsigned int c)
+	{
+		return configurations[c];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::layoutTraces()
+	{
+		// one row per trace and phase, zero past its end, as long as any horizon reads
+		unsigned int slots = 0;
+		for (unsigned int h = 0; h < traces.size(); h++)
+			slots = max(slots, traceSlots[h]);
+		for (unsigned int c = 0; c < configurations.size(); c++)
+			slots = max(slots, configurations[c].horizon);
+		if (slots == slotStride)
+			return;
+
+		slotStride = slots;
+		traceData.assign(traces.size() * NPhases * slotStride, 0);
+		for (unsigned int h = 0; h < traces.size(); h++)
+			for (unsigned int k = 0; k < traceSlots[h]; k++)
+				for (unsigned int phi = 0; phi < NPhases; phi++)
+					traceData[(h * NPhases + phi) * slotStride + k] = traces[h][k * NPhases + phi];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::SweepTask::execute(unsigned int worker, unsigned int begin, unsigned int end)
+	{
+		for (unsigned int n = begin; n < end; n++)
+			sweep->solveJob(worker, sweep->order[n]);
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::solveJob(unsigned int worker, unsigned int job)
+	{
+		Cop<NPhases, Objective>& cop = solvers[worker];
+		const unsigned int c = job / (unsigned int)traces.size();
+		const unsigned int h = job % (unsigned int)traces.size();
+		const CopJunction& junction = configurations[c];
+
+		cop.configure(junction);
+
+		if (solverHorizon[worker] != junction.horizon) {
+			cop.setHorizon(junction.horizon);
+			solverHorizon[worker] = junction.horizon;
+		}
+		// in place, phases one row apart
+		cop.setArrivals(&traceData[h * NPhases * slotStride], junction.horizon, 1, slotStride);
+
+		cop.solve();
+
+		const CopResult& result = cop.getResult();
+		CopSweepRecord& record = records[job];
+		record.configuration = c;
+		record.trace = h;
+		record.value = result.value;
+		record.stages = result.stats.stages;
+		record.seconds = result.stats.seconds;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopSweepStats CopSweep<NPhases, Objective>::run()
+	{
+		const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		const unsigned int jobs = (unsigned int)(configurations.size() * traces.size());
+		stats.configurations = (unsigned int)configurations.size();
+		stats.traces = (unsigned int)traces.size();
+		records.resize(jobs);
+		if (jobs == 0)
+			return stats;
+
+		layoutTraces();
+
+		// longest horizons first, then by configuration, so that a worker mostly
+		// takes jobs of the horizon its Cop already has
+		order.resize(jobs);
+		for (unsigned int n = 0; n < jobs; n++)
+			order[n] = n;
+		const unsigned int perConfiguration = (unsigned int)traces.size();
+		stable_sort(order.begin(), order.end(), [this, perConfiguration](unsigned int a, unsigned int b) {
+			return configurations[a / perConfiguration].horizon > configurations[b / perConfiguration].horizon; });
+
+		SweepTask task(this);
+		pool.run(task, jobs, 1);
+
+		stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+		stats.solvesPerSecond = stats.seconds > 0 ? jobs / stats.seconds : 0;
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	CopSweepStats CopSweep<NPhases, Objective>::getStats()
+	{
+		return stats;
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	const CopSweepRecord& CopSweep<NPhases, Objective>::getRecord(unsigned int c, unsigned int trace)
+	{
+		return records[c * traces.size() + trace];
+	}
+
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::writeCsv(ostream& out)
+	{
+		out << "configuration,trace,red,mingreen,maxgreen";
+		for (unsigned int phi = 0; phi < NPhases; phi++)
+			out << ",satflow" << phi;
+		out << ",horizon,M,value,stages,seconds\n";
+
+		for (unsigned int n = 0; n < records.size(); n++) {
+			const CopSweepRecord& record = records[n];
+			const CopJunction& junction = configurations[record.configuration];
+			out << record.configuration << ',' << record.trace << ',' << junction.red << ','
+				<< junction.mingreen << ',' << junction.maxgreen;
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				out << ',' << junction.satFlows[phi];
+			out << ',' << junction.horizon << ',' << junction.maxPhases << ',' << record.value << ','
+				<< record.stages << ',' << record.seconds << '\n';
+		}
+	}
+
+	template<typename V>
+	static void put(ostream& out, V value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(V));
+	}
+
+	/*
+	* Little-endian, no padding:
+	*   "COPS", uint32 version = 1, NPhases, objective, configurations, traces
+	*   per configuration: int32 red, mingreen, maxgreen,
+	*     float satflow[NPhases], uint32 horizon, M
+	*   per record, configuration major: int32 value, uint32 stages, float seconds
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	void CopSweep<NPhases, Objective>::writeBinary(ostream& out)
+	{
+		out.write("COPS", 4);
+		put<uint32_t>(out, 1);
+		put<uint32_t>(out, NPhases);
+		put<uint32_t>(out, Objective);
+		put<uint32_t>(out, (uint32_t)configurations.size());
+		put<uint32_t>(out, (uint32_t)traces.size());
+
+		for (unsigned int c = 0; c < configurations.size(); c++) {
+			const CopJunction& junction = configurations[c];
+			put<int32_t>(out, junction.red);
+			put<int32_t>(out, junction.mingreen);
+			put<int32_t>(out, junction.maxgreen);
+			for (unsigned int phi = 0; phi < NPhases; phi++)
+				put<float>(out, junction.satFlows[phi]);
+			put<uint32_t>(out, junction.horizon);
+			put<uint32_t>(out, junction.maxPhases);
+		}
+
+		for (unsigned int n = 0; n < records.size(); n++) {
+			put<int32_t>(out, records[n].value);
+			put<uint32_t>(out, records[n].stages);
+			put<float>(out, (float)records[n].seconds);
+		}
+	}
+
+	/* instantiations exported by the DLL */
+	template class CopSweep<2, COP_QUEUES>;
+	template class CopSweep<2, COP_STOPS>;
+	template class CopSweep<2, COP_DELAY>;
+	template class CopSweep<3, COP_QUEUES>;
+	template class CopSweep<3, COP_STOPS>;
+	template class CopSweep<3, COP_DELAY>;
+	template class CopSweep<4, COP_QUEUES>;
+	template class CopSweep<4, COP_STOPS>;
+	template class CopSweep<4, COP_DELAY>;
+}
@@ -0,0 +1,127 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPSWEEP_API __declspec(dllexport)
+#else
+#define COPSWEEP_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPSWEEP
+#define FROST_ALGORITHMS_COPSWEEP
+
+#include "COP97A.h"
+#include <vector>
+#include <iostream>
+
+namespace COP97A {
+
+	/*
+	* Values tried per parameter, every combination is one configuration.
+	* An empty list keeps the value of the base junction.
+	*/
+	struct CopSweepGrid
+	{
+		std::vector<int> reds;
+		std::vector<int> mingreens;
+		std::vector<int> maxgreens;
+		std::vector<float> satFlows;			// every phase alike, <= 0 = unset
+		std::vector<unsigned int> horizons;
+		std::vector<unsigned int> maxPhases;
+	};
+
+	/*
+	* One solve of the sweep: a configuration over one recorded trace
+	*/
+	struct CopSweepRecord
+	{
+		unsigned int configuration;
+		unsigned int trace;
+		int value;				// v_j(T), see CopResult
+		unsigned int stages;
+		double seconds;
+	};
+
+	/*
+	* How the last sweep went
+	*/
+	struct CopSweepStats
+	{
+		unsigned int configurations;
+		unsigned int traces;
+		double seconds;			// wall time of the whole sweep
+		double solvesPerSecond;
+	};
+
+	/*
+	* Calibration sweep: solves every configuration of a grid over every
+	* recorded arrival trace. The (configuration x trace) jobs are spread over
+	* one pool; each worker keeps a single Cop and reads the traces in place,
+	* jobs of one horizon handed out together so that its workspace and
+	* arrival tables are reused. A configuration with a horizon past the end
+	* of a trace sees no arrivals there.
+	*/
+	template<unsigned int NPhases, CopObjective Objective>
+	class CopSweep
+	{
+	public:
+		CopSweep(int threads = 1);
+		int getThreads();
+		void setBase(const CopJunction& junction);	//parameters not on the grid
+		void setGrid(const CopSweepGrid& grid);
+		void setDischargeProfile(std::shared_ptr<CopDischargeProfile> profile);	//NULL = linear
+		unsigned int addTrace(const std::vector<std::vector<int> >& arrivals);	//[slot][phase], as Cop::setArrivals
+		void clearTraces();
+		unsigned int getConfigurations();
+		unsigned int getTraces();
+		CopJunction getConfiguration(unsigned int c);
+
+		CopSweepStats run();	//blocks until done
+		CopSweepStats getStats();
+		const CopSweepRecord& getRecord(unsigned int c, unsigned int trace);
+		void writeCsv(std::ostream& out);		//one line per record, with its parameters
+		void writeBinary(std::ostream& out);	//see writeBinary in CopSweep.cpp
+
+	private:
+		// jobs [begin, end) of the solve order
+		class SweepTask : public CopTask
+		{
+		public:
+			SweepTask(CopSweep* sweep) : sweep(sweep) {}
+			void execute(unsigned int worker, unsigned int begin, unsigned int end);
+		private:
+			CopSweep* sweep;
+		};
+
+		void solveJob(unsigned int worker, unsigned int job);
+		void expand();
+		void layoutTraces();
+
+		int threads;
+		CopThreadPool pool;
+		std::vector<Cop<NPhases, Objective> > solvers;	// per worker
+		std::vector<unsigned int> solverHorizon;	// per worker, T of its Cop
+		CopJunction base;
+		CopSweepGrid grid;
+
+		std::vector<std::vector<int> > traces;	// as given, [slot * NPhases + phase]
+		std::vector<unsigned int> traceSlots;
+		unsigned int slotStride;		// longest trace or horizon
+		std::vector<int> traceData;		// [(trace * NPhases + phi) * slotStride + k]
+
+		std::vector<CopJunction> configurations;	// grid over base, last parameter fastest
+		std::vector<unsigned int> order;	// jobs, longest horizons first
+		std::vector<CopSweepRecord> records;	// [c * traces + trace]
+		CopSweepStats stats;
+	};
+
+	// defined in CopSweep.cpp
+	extern template class COPSWEEP_API CopSweep<2, COP_QUEUES>;
+	extern template class COPSWEEP_API CopSweep<2, COP_STOPS>;
+	extern template class COPSWEEP_API CopSweep<2, COP_DELAY>;
+	extern template class COPSWEEP_API CopSweep<3, COP_QUEUES>;
+	extern template class COPSWEEP_API CopSweep<3, COP_STOPS>;
+	extern template class COPSWEEP_API CopSweep<3, COP_DELAY>;
+	extern template class COPSWEEP_API CopSweep<4, COP_QUEUES>;
+	extern template class COPSWEEP_API CopSweep<4, COP_STOPS>;
+	extern template class COPSWEEP_API CopSweep<4, COP_DELAY>;
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Worker pool shared by the parallel COP modes
+#include "CopThreadPool.h"
+
+namespace COP97A{
+
+	CopThreadPool::CopThreadPool(unsigned int threads)
+		: task(NULL), items(0), chunk(1), next(0), generation(0), busy(0), stopping(false)
+	{
+		if (threads < 1)
+			threads = 1;
+
+		// worker 0 is the thread calling run()
+		for (unsigned int w = 1; w < threads; ++w)
+			workers.push_back(std::thread(&CopThreadPool::workerLoop, this, w));
+	}
+
+	CopThreadPool::~CopThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+
+		for (unsigned int w = 0; w < workers.size(); ++w)
+			workers[w].join();
+	}
+
+	unsigned int CopThreadPool::size()
+	{
+		return workers.size() + 1;
+	}
+
+	void CopThreadPool::run(CopTask& t, unsigned int n, unsigned int c)
+	{
+		if (n == 0)
+			return;
+
+		std::lock_guard<std::mutex> single(runLock);
+
+		if (workers.empty() || n <= c) {	// not worth waking anyone
+			t.execute(0, 0, n);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			task = &t;
+			items = n;
+			chunk = c > 0 ? c : 1;
+			next = 0;
+			busy = workers.size();
+			generation++;
+		}
+		wakeUp.notify_all();
+
+		drain(0);
+
+		std::unique_lock<std::mutex> guard(lock);
+		while (busy > 0)
+			done.wait(guard);
+		task = NULL;
+	}
+
+	void CopThreadPool::drain(unsigned int worker)
+	{
+		// dynamic chunks, later states have more candidates than early ones
+		for (;;) {
+			unsigned int begin = next.fetch_add(chunk);
+			if (begin >= items)
+				break;
+
+			unsigned int end = begin + chunk < items ? begin + chunk : items;
+			task->execute(worker, begin, end);
+		}
+	}
+
+	void CopThreadPool::workerLoop(unsigned int worker)
+	{
+		unsigned int seen = 0;
+
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				while (!stopping && generation == seen)
+					wakeUp.wait(guard);
+
+				if (stopping)
+					return;
+				seen = generation;
+			}
+
+			drain(worker);
+
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				busy--;
+			}
+			done.notify_one();
+		}
+	}
+}
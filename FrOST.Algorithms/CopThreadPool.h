@@ -0,0 +1,64 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPTHREADPOOL_API __declspec(dllexport) 
+#else
+#define COPTHREADPOOL_API  __declspec(dllimport) 
+#endif
+
+#ifndef FROST_ALGORITHMS_COPTHREADPOOL
+#define FROST_ALGORITHMS_COPTHREADPOOL
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace COP97A {
+
+	/*
+	* Work handed to the pool: execute is called for consecutive ranges
+	* [begin, end) of the items, with the index of the worker running it.
+	*/
+	class CopTask
+	{
+	public:
+		virtual ~CopTask() {}
+		virtual void execute(unsigned int worker, unsigned int begin, unsigned int end) = 0;
+	};
+
+	/*
+	* Fixed set of workers. run() blocks until every item is done, which is
+	* the barrier between COP stages. The calling thread works as worker 0.
+	*/
+	class CopThreadPool
+	{
+	public:
+		COPTHREADPOOL_API CopThreadPool(unsigned int threads);
+		COPTHREADPOOL_API ~CopThreadPool();
+		COPTHREADPOOL_API unsigned int size();
+		COPTHREADPOOL_API void run(CopTask& task, unsigned int items, unsigned int chunk = 4);
+
+	private:
+		CopThreadPool(const CopThreadPool&);
+		CopThreadPool& operator=(const CopThreadPool&);
+
+		void workerLoop(unsigned int worker);
+		void drain(unsigned int worker);
+
+		std::vector<std::thread> workers;
+		std::mutex runLock;		// one run at a time
+		std::mutex lock;
+		std::condition_variable wakeUp;
+		std::condition_variable done;
+
+		CopTask* task;
+		unsigned int items;
+		unsigned int chunk;
+		std::atomic<unsigned int> next;	// first item not yet taken
+		unsigned int generation;		// bumped for every run
+		unsigned int busy;				// helpers still inside the current run
+		bool stopping;
+	};
+}
+
+#endif
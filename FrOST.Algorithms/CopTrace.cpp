@@ -0,0 +1,326 @@
+// Memory mapped arrival traces
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "CopTrace.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace COP97A{
+
+	static const uint32_t traceVersion = 1;
+	static const size_t traceHeader = 32;
+
+	template<typename V>
+	static void put(ostream& out, V value)
+	{
+		out.write(reinterpret_cast<const char*>(&value), sizeof(V));
+	}
+
+	template<typename V>
+	static V get(const char* at)
+	{
+		V value;
+		memcpy(&value, at, sizeof(V));
+		return value;
+	}
+
+	static uint64_t indexOffset(uint64_t horizons, unsigned int slots, unsigned int phases)
+	{
+		uint64_t end = traceHeader + horizons * slots * phases * sizeof(int32_t);
+		return (end + 7) & ~(uint64_t)7;
+	}
+
+	// whether horizons x slots x phases counts fit in bytes after the header,
+	// each factor checked before it is multiplied so that nothing overflows
+	static bool arrivalsFit(uint64_t horizons, uint64_t slots, uint64_t phases, uint64_t bytes)
+	{
+		uint64_t room = (bytes - traceHeader) / sizeof(int32_t);
+		if (phases == 0 || slots == 0)
+			return true;
+		if (phases > room)
+			return false;
+		room /= phases;
+		if (slots > room)
+			return false;
+		return horizons <= room / slots;
+	}
+
+	CopTraceWriter::CopTraceWriter()
+		: phases(0), slots(0), failed(false)
+	{
+	}
+
+	CopTraceWriter::~CopTraceWriter()
+	{
+		close();
+	}
+
+	bool CopTraceWriter::open(const char* path, unsigned int nPhases, unsigned int nSlots)
+	{
+		close();
+		out.open(path, ios::binary | ios::trunc);
+		if (!out) {
+			cout << "Cannot open file.\n";
+			return false;
+		}
+		phases = nPhases;
+		slots = nSlots;
+		timestamps.clear();
+		failed = false;
+
+		// the counts and the index offset are filled in by close
+		out.write("COPT", 4);
+		put<uint32_t>(out, traceVersion);
+		put<uint32_t>(out, phases);
+		put<uint32_t>(out, slots);
+		put<uint64_t>(out, 0);
+		put<uint64_t>(out, 0);
+		return (bool)out;
+	}
+
+	bool CopTraceWriter::append(int64_t timestamp, const int* data)
+	{
+		if (!out.is_open() || (!timestamps.empty() && timestamp < timestamps.back()))
+			return false;
+
+		// int is 32 bits on every platform built for, so the rows go out as they are
+		out.write(reinterpret_cast<const char*>(data), (streamsize)slots * phases * sizeof(int32_t));
+		if (!out) {
+			failed = true;
+			return false;
+		}
+		timestamps.push_back(timestamp);
+		return true;
+	}
+
+	bool CopTraceWriter::append(int64_t timestamp, const vector<vector<int> >& data)
+	{
+		row.assign(slots * phases, 0);
+		for (unsigned int k = 0; k < slots && k < data.size(); k++)
+			for (unsigned int phi = 0; phi < phases && phi < data[k].size(); phi++)
+				row[k * phases + phi] = data[k][phi];
+		return append(timestamp, row.empty() ? NULL : &row[0]);
+	}
+
+	bool CopTraceWriter::close()
+	{
+		if (!out.is_open())
+			return !failed;
+
+		const uint64_t horizons = timestamps.size();
+		const uint64_t offset = indexOffset(horizons, slots, phases);
+		for (uint64_t at = traceHeader + horizons * slots * phases * sizeof(int32_t); at < offset; at++)
+			out.put(0);
+		for (uint64_t h = 0; h < horizons; h++)
+			put<int64_t>(out, timestamps[h]);
+
+		out.seekp(16);
+		put<uint64_t>(out, horizons);
+		put<uint64_t>(out, offset);
+		out.close();
+		failed = failed || out.fail();
+		return !failed;
+	}
+
+	uint64_t CopTraceWriter::size()
+	{
+		return timestamps.size();
+	}
+
+	CopTraceFile::CopTraceFile()
+		: base(NULL), bytes(0), file(NULL), mapping(NULL), phases(0), slots(0), horizons(0), arrivals(NULL), timestamps(NULL)
+	{
+	}
+
+	CopTraceFile::~CopTraceFile()
+	{
+		close();
+	}
+
+	bool CopTraceFile::open(const char* path)
+	{
+		close();
+
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+		if (handle == INVALID_HANDLE_VALUE) {
+			cout << "Cannot open file.\n";
+			return false;
+		}
+		file = handle;
+		LARGE_INTEGER length;
+		if (!GetFileSizeEx(handle, &length) || length.QuadPart < (LONGLONG)traceHeader) {
+			close();
+			return false;
+		}
+		bytes = (size_t)length.QuadPart;
+		mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) {
+			close();
+			return false;
+		}
+		base = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			cout << "Cannot open file.\n";
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < (off_t)traceHeader) {
+			::close(fd);
+			return false;
+		}
+		bytes = (size_t)info.st_size;
+		void* view = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);	// the mapping keeps the file
+		base = view == MAP_FAILED ? NULL : (const char*)view;
+#endif
+		if (base == NULL) {
+			close();
+			return false;
+		}
+
+		// everything the header claims has to be in the file
+		phases = get<uint32_t>(base + 8);
+		slots = get<uint32_t>(base + 12);
+		horizons = get<uint64_t>(base + 16);
+		const uint64_t offset = get<uint64_t>(base + 24);
+		const bool valid = memcmp(base, "COPT", 4) == 0 && get<uint32_t>(base + 4) == traceVersion
+			&& arrivalsFit(horizons, slots, phases, bytes) && offset == indexOffset(horizons, slots, phases) && offset <= bytes
+			&& horizons <= (bytes - offset) / sizeof(int64_t);
+		if (!valid) {
+			close();
+			return false;
+		}
+
+		arrivals = reinterpret_cast<const int32_t*>(base + traceHeader);
+		timestamps = reinterpret_cast<const int64_t*>(base + offset);
+		return true;
+	}
+
+	void CopTraceFile::close()
+	{
+#ifdef _WIN32
+		if (base != NULL)
+			UnmapViewOfFile(base);
+		if (mapping != NULL)
+			CloseHandle((HANDLE)mapping);
+		if (file != NULL)
+			CloseHandle((HANDLE)file);
+#else
+		if (base != NULL)
+			munmap((void*)base, bytes);
+#endif
+		base = NULL;
+		file = mapping = NULL;
+		bytes = 0;
+		phases = slots = 0;
+		horizons = 0;
+		arrivals = NULL;
+		timestamps = NULL;
+	}
+
+	bool CopTraceFile::isOpen()
+	{
+		return base != NULL;
+	}
+
+	unsigned int CopTraceFile::getPhases()
+	{
+		return phases;
+	}
+
+	unsigned int CopTraceFile::getSlots()
+	{
+		return slots;
+	}
+
+	uint64_t CopTraceFile::size()
+	{
+		return horizons;
+	}
+
+	int64_t CopTraceFile::getTimestamp(uint64_t horizon)
+	{
+		return timestamps[horizon];
+	}
+
+	const int* CopTraceFile::getArrivals(uint64_t horizon)
+	{
+		return arrivals + horizon * slots * phases;
+	}
+
+	int64_t CopTraceFile::find(int64_t time)
+	{
+		const int64_t* after = upper_bound(timestamps, timestamps + horizons, time);
+		return (int64_t)(after - timestamps) - 1;
+	}
+
+	/*
+	* Reads the text in blocks and the counts by hand, ifstream >> is what
+	* makes several GB of it slow
+	*/
+	int64_t convertTextTrace(const char* textPath, const char* tracePath, unsigned int phases, unsigned int slots,
+		int64_t start, int64_t step)
+	{
+		FILE* in = fopen(textPath, "rb");
+		if (in == NULL) {
+			cout << "Cannot open file.\n";
+			return -1;
+		}
+		CopTraceWriter writer;
+		if (!writer.open(tracePath, phases, slots)) {
+			fclose(in);
+			return -1;
+		}
+
+		const size_t perHorizon = (size_t)slots * phases;
+		vector<int> horizon(max((size_t)1, perHorizon));
+		vector<char> block(1 << 20);
+		size_t filled = 0, n = 0;
+		int value = 0;
+		bool inNumber = false, ok = perHorizon > 0;
+
+		do {
+			n = fread(&block[0], 1, block.size(), in);
+			if (n == 0)
+				block[0] = ' ';	// the end of the file ends the last number
+			for (size_t i = 0; i < max(n, (size_t)1) && ok; i++) {
+				const char c = block[i];
+				if (c >= '0' && c <= '9') {
+					value = value * 10 + (c - '0');
+					inNumber = true;
+				}
+				else if (c == '-')
+					ok = false;	// a negative count would break the bounds pruning relies on
+				else {
+					if (inNumber) {
+						horizon[filled++] = value;
+						if (filled == perHorizon) {
+							ok = writer.append(start + (int64_t)writer.size() * step, &horizon[0]);
+							filled = 0;
+						}
+					}
+					value = 0;
+					inNumber = false;
+				}
+			}
+		} while (n != 0 && ok);
+		fclose(in);
+
+		const int64_t written = (int64_t)writer.size();
+		return writer.close() && ok ? written : -1;
+	}
+}
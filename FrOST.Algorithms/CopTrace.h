@@ -0,0 +1,93 @@
+#ifdef FROSTALGORITHMS_EXPORTS
+#define  COPTRACE_API __declspec(dllexport)
+#else
+#define COPTRACE_API  __declspec(dllimport)
+#endif
+
+#ifndef FROST_ALGORITHMS_COPTRACE
+#define FROST_ALGORITHMS_COPTRACE
+
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+namespace COP97A {
+
+	/*
+	* Arrival traces of many horizons in one file. Little-endian, no padding:
+	*   "COPT", uint32 version = 1, phases, slots per horizon,
+	*   uint64 horizons, uint64 index offset
+	*   at 32: int32 arrivals [horizon][slot][phase], as Cop::setArrivals
+	*   at the index offset (8-aligned): int64 timestamps per horizon, nondecreasing
+	* Timestamps are in whatever unit the writer chose, ms by the converter.
+	*/
+	class CopTraceWriter
+	{
+	public:
+		COPTRACE_API CopTraceWriter();
+		COPTRACE_API ~CopTraceWriter();	//closes
+		COPTRACE_API bool open(const char* path, unsigned int phases, unsigned int slots);
+		COPTRACE_API bool append(int64_t timestamp, const int* arrivals);	//slots * phases, [slot * phases + phase]
+		COPTRACE_API bool append(int64_t timestamp, const std::vector<std::vector<int> >& arrivals);	//[slot][phase], missing ones empty
+		COPTRACE_API bool close();	//writes the index, false if any write failed
+		COPTRACE_API uint64_t size();	//horizons appended
+
+	private:
+		CopTraceWriter(const CopTraceWriter&);
+		CopTraceWriter& operator=(const CopTraceWriter&);
+
+		std::ofstream out;
+		unsigned int phases, slots;
+		std::vector<int64_t> timestamps;
+		std::vector<int32_t> row;	// one horizon, for the vector append
+		bool failed;
+	};
+
+	/*
+	* A trace file mapped read-only: horizons are looked up by time through
+	* the index and handed to the solver in place, e.g.
+	*   cop.setArrivals(trace.getArrivals(h), trace.getSlots(), trace.getPhases());
+	* Pointers stay valid until close. Solvers of any thread may share one.
+	*/
+	class CopTraceFile
+	{
+	public:
+		COPTRACE_API CopTraceFile();
+		COPTRACE_API ~CopTraceFile();	//closes
+		COPTRACE_API bool open(const char* path);	//false if missing, not a trace, of another version or cut short
+		COPTRACE_API void close();
+		COPTRACE_API bool isOpen();
+		COPTRACE_API unsigned int getPhases();
+		COPTRACE_API unsigned int getSlots();
+		COPTRACE_API uint64_t size();	//horizons
+		COPTRACE_API int64_t getTimestamp(uint64_t horizon);
+		COPTRACE_API const int* getArrivals(uint64_t horizon);	//slots * phases, [slot * phases + phase]
+		COPTRACE_API int64_t find(int64_t time);	//last horizon at or before time, -1 if none
+
+	private:
+		CopTraceFile(const CopTraceFile&);
+		CopTraceFile& operator=(const CopTraceFile&);
+
+		const char* base;	// the mapping
+		size_t bytes;
+		void* file;			// platform handles
+		void* mapping;
+		unsigned int phases, slots;
+		uint64_t horizons;
+		const int32_t* arrivals;
+		const int64_t* timestamps;
+	};
+
+	/*
+	* Text as read by Cop::loadFromFile, whitespace separated counts of slots
+	* rows of phases per horizon, horizon after horizon, into a trace file;
+	* horizon h is stamped start + h * step. A partial last horizon is dropped.
+	* Returns the horizons written, -1 if a file could not be opened or written
+	* or a count is negative.
+	*/
+	COPTRACE_API int64_t convertTextTrace(const char* textPath, const char* tracePath, unsigned int phases, unsigned int slots,
+		int64_t start, int64_t step);
+}
+
+#endif
@@ -76,10 +76,19 @@ namespace REAP1{
 		M= mp;
 	}
 
-	void ReAP1::setArrivals(std::vector<std::vector<int> > arrivals){
+	void ReAP1::setArrivals(const std::vector<std::vector<int> >& arrivals){
 		arrivalData = arrivals;
+		arrivalView = NULL;
 	};
 
+	void ReAP1::setArrivals(const int* data, unsigned int slots, unsigned int slotStride, unsigned int phaseStride){
+		// slot k, phase p at data[k * slotStride + p * phaseStride], until the next setArrivals or load
+		arrivalView = data;
+		viewSlots = slots;
+		viewSlotStride = slotStride;
+		viewPhaseStride = phaseStride;
+	}
+
 	int ReAP1::getArrivals(int a, int b, int phi) {
 
 		if (a == b)
@@ -88,6 +97,16 @@ namespace REAP1{
 		int vehicles = 0;
 		int cc = a;
 
+		if (arrivalView != NULL) {
+			do {
+				if ((unsigned int)cc < viewSlots)
+					vehicles += arrivalView[cc * viewSlotStride + phi * viewPhaseStride];
+				cc++;
+			} while (cc < b);
+
+			return vehicles;
+		}
+
 		do {
 			vehicles += arrivalData[cc][phi];
 			cc++;
@@ -108,6 +127,12 @@ namespace REAP1{
 		return optControlSequence;
 	}; 
 
+	int ReAP1::getOptimalControl(int out[], int capacity){
+		int size = (int)optControlSequence.size();
+		std::copy(optControlSequence.begin(), optControlSequence.begin() + std::min(size, std::max(0, capacity)), out);
+		return size;
+	}
+
 	int ReAP1::getInitialPhase(){
 		return initialPhase;
 	}
@@ -132,6 +157,8 @@ namespace REAP1{
 		setSaturationFlow(0, -1.0); setSaturationFlow(1, -1.0); setSaturationFlow(2, -1.0);
 		phases = std::vector<int>(phaseSeq, phaseSeq + sizeof (phaseSeq) /sizeof (phaseSeq[0]));
 		output = false;
+		arrivalView = NULL;
+		viewSlots = 0;
 		resizeArrivals();
 	}
 
@@ -182,14 +209,14 @@ namespace REAP1{
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	ReAP1::ReAP1(std::vector<int> data, int nphases, int iphase){
+	ReAP1::ReAP1(const std::vector<int>& data, int nphases, int iphase){
 		initParameters();
 		if(!loadFromVector(data, nphases))
 			exit(0);
 		idxCurrentPh = initialPhase = iphase;
 	};
 
-	ReAP1::ReAP1(std::vector<std::vector<int> > data, int iphase, int horizon){
+	ReAP1::ReAP1(const std::vector<std::vector<int> >& data, int iphase, int horizon){
 		initParameters();
 		setHorizon(horizon);
 		arrivalData = data;
@@ -217,6 +244,7 @@ namespace REAP1{
 		lambda = 0.1;  
 
 		random = false;
+		arrivalView = NULL;
 
 		/* ------Agent initialised -----*/
 	}
@@ -234,6 +262,7 @@ namespace REAP1{
 			return false;
 		}
 
+		arrivalView = NULL;
 		for (y = 0; y < T; y++) {
 			for (x = 0; x < phases.size(); x++) {
 
@@ -250,6 +279,7 @@ namespace REAP1{
 		//ifstream in(filename);
 		int ic = 0;
 		int dataI;
+		arrivalView = NULL;
 		for (unsigned int ix = 0; ix < size; ++ix)
 		{
 			dataI = data[ix];
@@ -266,8 +296,9 @@ namespace REAP1{
 		return true;
 	}
 
-	bool ReAP1::loadFromVector(std::vector<int> data, int nPhases) {
+	bool ReAP1::loadFromVector(const std::vector<int>& data, int nPhases) {
 		
+		arrivalView = NULL;
 		for (unsigned int ix = 0; ix < data.size(); ++ix)
 		{
 			arrivalData[ix/nPhases][ix%nPhases] = data[ix];
@@ -285,7 +316,7 @@ namespace REAP1{
 		for (unsigned int i = 0; i < T; ++i) {
 			cout << i+1 << "\t";
 			for (unsigned int j = 0; j < phases.size(); ++j) {
-				cout << arrivalData[i][j] << "\t";
+				cout << getArrivals(i, i + 1, j) << "\t";
 			}
 			cout << endl;
 		}
@@ -31,16 +31,17 @@ namespace REAP1 {
 		//ReAP1();
 		REAP1_API ReAP1();
 		REAP1_API ReAP1(char*, int);	//load from file
-		REAP1_API ReAP1(std::vector<int>, int, int);	//load from vector
+		REAP1_API ReAP1(const std::vector<int>&, int, int);	//load from vector
 		REAP1_API ReAP1(char*, int, int, int); //load from string
 		REAP1_API ReAP1(char*, int, int); //load from file with Horizon
-		REAP1_API ReAP1::ReAP1(std::vector<std::vector<int> >, int iphase, int horizon); // load from multiarray
+		REAP1_API ReAP1::ReAP1(const std::vector<std::vector<int> >&, int iphase, int horizon); // load from multiarray
 		REAP1_API ReAP1::ReAP1(int iphase, int horizon);
 		REAP1_API std::vector<int> getFeasibleGreens(int, int);
 		REAP1_API int getInitialPhase();
 		REAP1_API  int getRed();
 		REAP1_API int getArrivals(int, int, int);
 		REAP1_API std::vector<int> getOptimalControl(); 
+		REAP1_API int getOptimalControl(int out[], int capacity);	//into buffer, returns the sequence length
 		REAP1_API float getSaturationFlow(int); 
 		REAP1_API void setSaturationFlow(int phi, float satFlow);
 		REAP1_API void setStartupLostTime(float time);
@@ -51,7 +52,8 @@ namespace REAP1 {
 		REAP1_API void setLanePhases(int phi, int lanes);
 		REAP1_API void setHorizon(int h);
 		REAP1_API void setMaxPhCompute(int mp);
-		REAP1_API void setArrivals(std::vector<std::vector<int> > arrivals);
+		REAP1_API void setArrivals(const std::vector<std::vector<int> >& arrivals);	//copied
+		REAP1_API void setArrivals(const int* data, unsigned int slots, unsigned int slotStride = 3, unsigned int phaseStride = 1);	//not copied, read in place; later slots are empty
 		REAP1_API int getArrivalEarliest(int, int, int, int); //NEW
 
 		REAP1_API void resizeArrivals();
@@ -67,7 +69,7 @@ namespace REAP1 {
 		REAP1_API std::vector<int> RunREAP();
 		REAP1_API bool loadFromFile(char*);
 		REAP1_API bool loadFromSeq(char*, unsigned int, int);
-		REAP1_API bool loadFromVector(std::vector<int>, int);
+		REAP1_API bool loadFromVector(const std::vector<int>&, int);
 		REAP1_API void initParameters();
 
 		REAP1_API void setOutput(bool);
@@ -118,6 +120,9 @@ namespace REAP1 {
 		std::vector<int> phases; // A = 0, B = 1, C = 2
 		std::vector<int> optControlSequence; // A = 0, B = 1, C = 2
 		std::vector< std::vector<int> > arrivalData;		//---------------------> state rep
+		const int* arrivalView;		// caller memory given to setArrivals, NULL = arrivalData
+		unsigned int viewSlots;		// slots past these are empty
+		unsigned int viewSlotStride, viewPhaseStride;
 		std::vector< std::vector<int> > v; //v_j(s_j);
 		std::vector< std::vector<int> > x_star; // optimal solutions x*_j(s_j)
 		
@@ -0,0 +1,33 @@
+// Benchmarks and checks of the COP solvers: FrOSTBench <command> [arguments]
+#include <iostream>
+#include <cstring>
+#include "Bench.h"
+
+using namespace std;
+
+struct BenchCommand
+{
+	const char* name;
+	int (*run)(int argc, char* argv[]);
+	const char* usage;
+};
+
+static const BenchCommand commands[] = {
+	{ "differential", runDifferential, "[cases] [csv]\tevery mode and the original DP against the scalar Cop" },
+	{ "horizons", runHorizons, "[repeats]\tRunCOP at T = 70, 140 and 280, the original DP against Cop97A" },
+	{ "allocations", runAllocations, "[steps]\theap allocations of steady-state solves, all have to be 0" },
+	{ "objectives", runObjectives, "[M]\tsolveAll against one solve per objective at T = 70, 140 and 280" },
+};
+
+int main(int argc, char* argv[])
+{
+	const unsigned int count = sizeof(commands) / sizeof(commands[0]);
+	for (unsigned int c = 0; argc >= 2 && c < count; c++)
+		if (strcmp(argv[1], commands[c].name) == 0)
+			return commands[c].run(argc - 2, argv + 2);
+
+	cout << "usage: FrOSTBench <command> [arguments]\n";
+	for (unsigned int c = 0; c < count; c++)
+		cout << "  " << commands[c].name << ' ' << commands[c].usage << '\n';
+	return 2;
+}
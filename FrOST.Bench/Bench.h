@@ -0,0 +1,14 @@
+#ifndef FROST_BENCH_BENCH
+#define FROST_BENCH_BENCH
+
+/*
+* Benchmarks and checks of the COP solvers, one command each. A command
+* gets the arguments after its name and returns the process exit code,
+* nonzero if a check failed.
+*/
+int runDifferential(int argc, char* argv[]);
+int runHorizons(int argc, char* argv[]);
+int runAllocations(int argc, char* argv[]);
+int runObjectives(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,109 @@
+// Heap allocations of steady-state solves, counted by replacing the global operator new
+#include <iostream>
+#include <atomic>
+#include <new>
+#include <random>
+#include <cstdlib>
+#include "COP97A.h"
+#include "Bench.h"
+
+using namespace std;
+using namespace COP97A;
+
+static atomic<unsigned long> allocations(0);
+
+void* operator new(size_t bytes)
+{
+	allocations++;
+	void* block = malloc(bytes != 0 ? bytes : 1);
+	if (block == NULL)
+		throw bad_alloc();
+	return block;
+}
+
+void* operator new[](size_t bytes)
+{
+	return operator new(bytes);
+}
+
+void operator delete(void* block) noexcept
+{
+	free(block);
+}
+
+void operator delete[](void* block) noexcept
+{
+	free(block);
+}
+
+void operator delete(void* block, size_t) noexcept
+{
+	free(block);
+}
+
+void operator delete[](void* block, size_t) noexcept
+{
+	free(block);
+}
+
+/*
+* Allocations of steps solves after the first, each on new arrivals through
+* setArrivals as the controller steps; first gets those of building the
+* solver and its first solve
+*/
+static unsigned long steadyState(unsigned int T, int threads, unsigned int steps, unsigned long& first)
+{
+	mt19937 random(3);
+	vector<vector<int> > arrivals(T, vector<int>(3));
+	const unsigned long built = allocations;
+	Cop97A cop(2, T);
+	cop.setMaxPhCompute(7);
+	cop.setMinGreenTime(5);
+	cop.setMaxGreenTime(50);
+	cop.setRedTime(2);
+	cop.setSaturationFlow(0, 1800);
+	cop.setSaturationFlow(1, 1400);
+	cop.setSaturationFlow(2, 1800);
+	cop.setLanePhases(2, 2);
+	cop.setThreads(threads);
+	cop.setArrivals(arrivals);
+	cop.solve();
+	first = allocations - built;
+
+	unsigned long counted = 0;
+	for (unsigned int s = 0; s < steps; s++) {
+		for (unsigned int k = 0; k < T; k++)
+			for (unsigned int p = 0; p < 3; p++)
+				arrivals[k][p] = random() % 2;
+		const unsigned long before = allocations;
+		cop.setInitialPhase(2);
+		cop.setArrivals(arrivals);
+		cop.solve();
+		counted += allocations - before;
+	}
+	return counted;
+}
+
+/*
+* allocations [steps]: every steady-state solve has to allocate nothing,
+* serial and on the thread pool. The first solve has to allocate, or the
+* counter does not see the solver's heap, as with the library in a DLL.
+*/
+int runAllocations(int argc, char* argv[])
+{
+	const unsigned int steps = argc >= 1 ? (unsigned int)atoi(argv[0]) : 20;
+	const unsigned int horizons[] = { 70, 280 };
+	const int threads[] = { 1, 3 };
+	unsigned int failures = 0;
+
+	for (unsigned int h = 0; h < 2; h++)
+		for (unsigned int t = 0; t < 2; t++) {
+			unsigned long first = 0;
+			const unsigned long counted = steadyState(horizons[h], threads[t], steps, first);
+			cout << "T=" << horizons[h] << ", " << threads[t] << " thread(s): " << first << " allocations to set up, "
+				<< counted << " in the next " << steps << " solves\n";
+			if (counted != 0 || first == 0)
+				failures++;
+		}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// Differential check: every mode and the original DP against the scalar Cop, see CopDifferential
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include "CopDifferential.h"
+#include "Bench.h"
+
+using namespace std;
+using namespace COP97A;
+
+template<unsigned int NPhases, CopObjective Objective>
+static unsigned int differential(unsigned int cases, unsigned int seed, ostream* csv)
+{
+	CopDifferential<NPhases, Objective> check;
+	CopDifferentialOptions options;
+	options.cases = cases;
+	options.seed = seed;
+	options.repeats = 3;
+	check.setOptions(options);
+	const CopDifferentialStats stats = check.run();
+	const vector<CopDifferentialMode> modes = check.getModes();
+
+	cout << NPhases << " phases, objective " << Objective << ": " << stats.cases << " cases, "
+		<< stats.inconsistent << " inconsistent, " << stats.indexQuirks << " index quirks, "
+		<< stats.aboveOptimum << " above and " << stats.belowOptimum << " below the optimum, mean gap "
+		<< stats.meanGap << ", " << stats.incomplete << " incomplete, " << stats.seconds << " s\n";
+	unsigned int failures = stats.inconsistent;
+	for (unsigned int m = 0; m < modes.size(); m++) {
+		cout << "  " << modes[m].name << ": " << stats.differences[m] << " differ, x" << stats.speedups[m];
+		if (stats.originalCases > 0)
+			cout << ", x" << stats.originalSpeedups[m] << " the original";
+		cout << '\n';
+		failures += stats.differences[m];
+	}
+	if (stats.originalCases > 0) {
+		cout << "  original: " << stats.originalCases << " cases, " << stats.originalDifferences
+			<< " differ, baseline x" << stats.originalSpeedup << '\n';
+		failures += stats.originalDifferences;
+		if (csv != NULL)
+			check.writeCsv(*csv);
+	}
+	return failures;
+}
+
+/*
+* differential [cases] [csv]: 2, 3 and 4 phases under every objective,
+* the cases of 3 phases and delay, which the original DP solves too, to csv
+*/
+int runDifferential(int argc, char* argv[])
+{
+	const unsigned int cases = argc >= 1 ? (unsigned int)atoi(argv[0]) : 100;
+	ofstream out;
+	if (argc >= 2) {
+		out.open(argv[1]);
+		if (!out) {
+			cout << "Cannot open file.\n";
+			return 1;
+		}
+	}
+	ostream* csv = out.is_open() ? &out : NULL;
+
+	unsigned int failures = 0;
+	failures += differential<2, COP_QUEUES>(cases, 1, csv);
+	failures += differential<2, COP_STOPS>(cases, 2, csv);
+	failures += differential<2, COP_DELAY>(cases, 3, csv);
+	failures += differential<3, COP_QUEUES>(cases, 4, csv);
+	failures += differential<3, COP_STOPS>(cases, 5, csv);
+	failures += differential<3, COP_DELAY>(cases, 6, csv);
+	failures += differential<4, COP_QUEUES>(cases, 7, csv);
+	failures += differential<4, COP_STOPS>(cases, 8, csv);
+	failures += differential<4, COP_DELAY>(cases, 9, csv);
+	cout << failures << " failures\n";
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// RunCOP at T = 70, 140 and 280: the original DP against Cop97A
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "COP97A.h"
+#include "CopOriginal.h"
+#include "Bench.h"
+
+using namespace std;
+using namespace COP97A;
+
+// the controller's junction: 3 phases, greens 5 .. 50, red 2
+template<class Solver>
+static void configure(Solver& cop)
+{
+	cop.setMaxPhCompute(7);
+	cop.setMinGreenTime(5);
+	cop.setMaxGreenTime(50);
+	cop.setRedTime(2);
+	cop.setStartupLostTime(2.0f);
+	cop.setSaturationFlow(0, 1800);
+	cop.setSaturationFlow(1, 1400);
+	cop.setSaturationFlow(2, 1800);
+	cop.setLanePhases(0, 1);
+	cop.setLanePhases(1, 1);
+	cop.setLanePhases(2, 2);
+}
+
+// milliseconds per RunCOP, setArrivals included as the controller calls both every step
+template<class Solver>
+static double timeRunCop(Solver& cop, const vector<vector<int> >& arrivals, unsigned int repeats)
+{
+	const chrono::steady_clock::time_point started = chrono::steady_clock::now();
+	for (unsigned int r = 0; r < repeats; r++) {
+		cop.setInitialPhase(2);
+		cop.setArrivals(arrivals);
+		cop.RunCOP();
+	}
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - started).count() / repeats;
+}
+
+/*
+* horizons [repeats]: per T, both solvers on the same arrivals, one vehicle
+* in a fifth of the slots of every phase; the sequences must agree
+*/
+int runHorizons(int argc, char* argv[])
+{
+	const unsigned int repeats = argc >= 1 ? max(1, atoi(argv[0])) : 0;	// 0 = about 2000 / T
+	const unsigned int horizons[] = { 70, 140, 280 };
+	unsigned int failures = 0;
+
+	for (unsigned int h = 0; h < 3; h++) {
+		const unsigned int T = horizons[h];
+		const unsigned int n = repeats > 0 ? repeats : max(1u, 2000 / T);
+		mt19937 random(7);
+		vector<vector<int> > arrivals(T, vector<int>(3));
+		for (unsigned int s = 0; s < T; s++)
+			for (unsigned int p = 0; p < 3; p++)
+				arrivals[s][p] = random() % 5 == 0;
+
+		CopOriginal original(2, T);
+		Cop97A cop(2, T);
+		configure(original);
+		configure(cop);
+
+		// RunCOP of the original prints its sequence, a stream without a buffer drops it
+		streambuf* shown = cout.rdbuf(NULL);
+		const double originalMs = timeRunCop(original, arrivals, n);
+		cout.rdbuf(shown);
+		cout.clear();
+		const double copMs = timeRunCop(cop, arrivals, n);
+
+		const bool same = original.getOptimalControl() == cop.getOptimalControl();
+		if (!same)
+			failures++;
+		cout << "T=" << T << ": original " << originalMs << " ms, Cop97A " << copMs << " ms, x"
+			<< originalMs / copMs << (same ? "" : ", sequences differ") << '\n';
+	}
+	return failures == 0 ? 0 : 1;
+}
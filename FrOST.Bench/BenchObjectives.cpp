@@ -0,0 +1,101 @@
+// solveAll against one solve per objective
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include "COP97A.h"
+#include "Bench.h"
+
+using namespace std;
+using namespace COP97A;
+
+template<CopObjective Objective>
+static void configure(Cop<3, Objective>& cop, unsigned int maxPhases, const vector<vector<int> >& arrivals)
+{
+	cop.setMaxPhCompute(maxPhases);
+	cop.setMinGreenTime(5);
+	cop.setMaxGreenTime(50);
+	cop.setRedTime(2);
+	cop.setStartupLostTime(2);
+	cop.setSaturationFlow(0, 1800);
+	cop.setSaturationFlow(1, 1400);
+	cop.setSaturationFlow(2, 1800);
+	cop.setLanePhases(2, 2);
+	cop.setArrivals(arrivals);
+}
+
+static double since(chrono::steady_clock::time_point started, unsigned int repeats)
+{
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - started).count() / repeats;
+}
+
+static bool same(const CopResult& a, const CopResult& b)
+{
+	return a.sequence == b.sequence && a.value == b.value;
+}
+
+/*
+* objectives [M]: per T = 70, 140, 280, milliseconds of one delay solve,
+* of the three objectives solved apart and of solveAll, whose results have
+* to be those of the solves apart. M 9 by default, where queues often
+* need more stages than delay; with a small M all objectives run as many.
+*/
+int runObjectives(int argc, char* argv[])
+{
+	const unsigned int maxPhases = argc >= 1 ? (unsigned int)atoi(argv[0]) : 9;
+	const unsigned int horizons[] = { 70, 140, 280 };
+	mt19937 random(1);
+	unsigned int failures = 0;
+
+	for (unsigned int h = 0; h < 3; h++) {
+		const unsigned int T = horizons[h];
+		const unsigned int repeats = 20000 / T;
+		vector<vector<int> > arrivals(T, vector<int>(3));
+		for (unsigned int s = 0; s < T; s++)
+			for (unsigned int p = 0; p < 3; p++)
+				arrivals[s][p] = random() % 3 == 0 ? 1 + random() % 2 : 0;
+
+		Cop<3, COP_QUEUES> queues(2, T);
+		Cop<3, COP_STOPS> stops(2, T);
+		Cop<3, COP_DELAY> delay(2, T), all(2, T);
+		configure(queues, maxPhases, arrivals);
+		configure(stops, maxPhases, arrivals);
+		configure(delay, maxPhases, arrivals);
+		configure(all, maxPhases, arrivals);
+
+		chrono::steady_clock::time_point started = chrono::steady_clock::now();
+		for (unsigned int r = 0; r < repeats; r++) {
+			queues.setInitialPhase(2);
+			stops.setInitialPhase(2);
+			delay.setInitialPhase(2);
+			queues.solve();
+			stops.solve();
+			delay.solve();
+		}
+		const double three = since(started, repeats);
+
+		started = chrono::steady_clock::now();
+		for (unsigned int r = 0; r < repeats; r++) {
+			delay.setInitialPhase(2);
+			delay.solve();
+		}
+		const double one = since(started, repeats);
+
+		started = chrono::steady_clock::now();
+		for (unsigned int r = 0; r < repeats; r++) {
+			all.setInitialPhase(2);
+			all.solveAll();
+		}
+		const double sweep = since(started, repeats);
+
+		const bool agree = same(all.getResult(COP_QUEUES), queues.getResult())
+			&& same(all.getResult(COP_STOPS), stops.getResult()) && same(all.getResult(COP_DELAY), delay.getResult());
+		if (!agree)
+			failures++;
+		cout << "T=" << T << ": one " << one << " ms, three apart " << three << " ms, solveAll " << sweep << " ms ("
+			<< sweep / one << "x one, " << sweep / three << "x three), stages "
+			<< all.getResult(COP_QUEUES).stats.stages << '/' << all.getResult(COP_STOPS).stats.stages << '/'
+			<< all.getResult(COP_DELAY).stats.stages << (agree ? "" : ", results differ") << '\n';
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -23,6 +23,7 @@
 #include <windows.h>
 #include <process.h>
 #include <random>
+#include <mutex>
 
 extern "C" {
 #include "programmer.h"
@@ -45,6 +46,8 @@ using namespace std;
 #define		ALL_RED 2
 #define		HORIZON_SIZE 70
 #define		MAX_SEQUENCE 7
+#define		COP_BUDGET_MS 400	/* solve deadline, leaves margin in the 0.5s step */
+#define		COP_CACHE_BYTES (1 << 20)	/* results of repeated horizons, e.g. empty ones at low demand */
 #define		UPSTREAM_DETECTOR_DISTANCE 700       /* metres */
 
 /* ---------------------------------------------------------------------
@@ -104,7 +107,11 @@ static DETECTOR* stoplDetectors[4];
 const char*	phases [3] = {"A", "B", "C"}; /* A = WE - SE ; B = WN - ES (protected left turn) ; C = NS - SN */
 std::vector<ARRIVALDATA> detectedArrivals;
 std::vector<std::vector<SIGPRI> > phasing;
-std::vector<std::vector<int> > arrivalsHorizon;
+int arrivalsHorizon[2][HORIZON_SIZE][PHASE_COUNT];	/* double buffered, the COP thread reads one in place */
+int switchHorizon[HORIZON_SIZE][PHASE_COUNT];	/* the solver's buffer from the switch point on, COP thread only */
+int horizonBuffer = 0;		/* filled by updateHorizon */
+int latestBuffer = 0;		/* last one it completed */
+int solverBuffer = 1;		/* read by the running COP thread */
 double leftTurnProportion = 0.1; /* simplified turning proportions, must agree OD Matrix */ //nbefore 0.2
 double rightTurnProportion = 0.1;
 const char * phasing_file = "c:\\temp\\phasing.txt";
@@ -114,10 +121,11 @@ const char * phasing_file = "c:\\temp\\phasing.txt";
  * controller
  * --------------------------------------------------------------------- */
 
-vector<COP97A::Cop97A> instances;
-vector<int> control;
+vector<COP97A::Cop97A> instances;	/* configured once in init, then only read */
+COP97A::CopSolveContext<PHASE_COUNT, COP97A::COP_DELAY> solveContext;	/* tables and result of the COP thread */
 vector<CONTROLDATA> controlSeq;
 vector<CONTROLDATA> tempSeq;
+std::mutex sequenceLock;	/* tempSeq and isSequenceReady, shared with the COP thread */
 
 HANDLE hThread = NULL;
 unsigned threadID;
@@ -128,10 +136,39 @@ bool isAllRed = false;
 
 float lastControlTime = 0.0;
 int nextPhase = INITIAL_PHASE_INDEX;
+int solverPhase = INITIAL_PHASE_INDEX;	/* phase taking the switch point, as the COP thread was started */
+unsigned int solverDelay = 0;	/* steps from then to the switch point */
 int nextControl = 0;
 int currentControl = 0;
 int seqIndex = 0;
 
+/* -----------------------------------------------------------------------
+* Solves for phase starting delay steps from now, at the switch point: the
+* one start the controller can take, as phases rotate in a fixed order and
+* a skipped phase is a zero green in the sequence. The sequence is read
+* from phase on, so the solve starts there. What arrives before the switch
+* point queues for it, so it joins the first slot. Returns the sequence length
+* --------------------------------------------------------------------- */
+
+int solveFromSwitch(int phase, unsigned int delay, int control[])
+{
+	for (int p = 0; p < PHASE_COUNT; p++)
+	{
+		switchHorizon[0][p] = 0;
+		for (unsigned int k = 0; k <= delay && k < HORIZON_SIZE; k++)
+			switchHorizon[0][p] += arrivalsHorizon[solverBuffer][k][p];
+		for (unsigned int k = 1; k < HORIZON_SIZE; k++)
+			switchHorizon[k][p] = k + delay < HORIZON_SIZE ? arrivalsHorizon[solverBuffer][k + delay][p] : 0;
+	}
+
+	solveContext.setInitialPhase(phase);
+	instances[0].solve(&switchHorizon[0][0], HORIZON_SIZE, solveContext,
+		std::chrono::steady_clock::now() + std::chrono::milliseconds(COP_BUDGET_MS));
+
+	int length = solveContext.getOptimalControl(control, MAX_SEQUENCE);
+	return length > MAX_SEQUENCE ? MAX_SEQUENCE : length;
+}
+
 /* -----------------------------------------------------------------------
 * Runs algorithm on a separate thread and updates control sequence
 * --------------------------------------------------------------------- */
@@ -141,27 +178,29 @@ unsigned __stdcall COPThreadFunc( void* data )
 	isThreadRunning = true;
 	
 	clock_t tStart = clock();
-	instances[0].setArrivals(arrivalsHorizon);	/*	set to latest horizon */
-	control = instances[0].RunCOP();
+	int control[MAX_SEQUENCE];
+	int phase = solverPhase;
+	int controlLength = solveFromSwitch(phase, solverDelay, control);
 	/* to run it at a predetermined frequency, add ms to ttaken and sleep, e.g, Sleep( 5000L - ttaken ); */
 	double ttaken = (double)(clock() - tStart)/CLOCKS_PER_SEC;
-	if (!isAllRed)
+	vector<CONTROLDATA> seq;
+	bool isBuilt = !isAllRed;
+	if (isBuilt)
 	{				/* late check to avoid algorithm latency issues */
 		string str;
 		std::stringstream message;
-		int cPhase = nextPhase;
-		tempSeq.clear();			
-		tempSeq.reserve(MAX_SEQUENCE+1);		// TODO: check it
+		int cPhase = phase;
+		seq.reserve(MAX_SEQUENCE+1);		// TODO: check it
 
-		for (vector<int>::iterator i = control.begin(); i != control.end(); ++i)
+		for (int i = 0; i < controlLength; ++i)
 		{
-			int dur = *i;
+			int dur = control[i];
 			if (dur > 0)				/*	skip phase	*/
 			{
 				CONTROLDATA ctrl;
 				ctrl.phase = cPhase;		
 				ctrl.duration = dur;
-				tempSeq.insert(tempSeq.begin(),ctrl);
+				seq.insert(seq.begin(),ctrl);
 			}
 
 			message << phases[cPhase] << ":" << dur << "\t";
@@ -173,8 +212,13 @@ unsigned __stdcall COPThreadFunc( void* data )
 		hh = hh / 60;
 		qps_GUI_printf("\a COP: %im %4.2fs \t%4.2fs \t %s ",(int)hh ,mm, ttaken, message.str().c_str());
 	}
-	isThreadRunning = false;
+
+	sequenceLock.lock();		/*	publish, the main thread reads them at the switch points	*/
+	if (isBuilt)
+		tempSeq.swap(seq);
 	isSequenceReady = tempSeq.size() > 0;
+	sequenceLock.unlock();
+	isThreadRunning = false;
 	return 0;
 } 
 
@@ -263,14 +307,11 @@ void qpx_NET_postOpen(void)
 	loadPhasingFile();
 
 	// clockwise
-	arrivalsHorizon.resize(HORIZON_SIZE);
 	for (int h= 0; h < HORIZON_SIZE; h++)
 	{
-		arrivalsHorizon[h].resize(PHASE_COUNT);
-
 		for (int p=0; p < PHASE_COUNT; p++)
 		{
-			arrivalsHorizon[h][p]= 0; //Init all to zero
+			arrivalsHorizon[0][h][p]= arrivalsHorizon[1][h][p]= 0; //Init all to zero
 		}
 	}
 
@@ -332,6 +373,10 @@ void qpx_NET_postOpen(void)
 	instances[0].setLanePhases(1, 1);
 	instances[0].setLanePhases(2, 2);
 
+	/*	no warm start: each step shifts the horizon, or folds new arrivals into its first slot
+		when taken from the switch point, so nothing before the first changed slot is left to reuse	*/
+	instances[0].setResultCache(COP_CACHE_BYTES);
+
 }
 
 
@@ -402,7 +447,7 @@ void clearHorizon()
 	{
 		for (int p= 0; p <PHASE_COUNT; p++)	
 		{
-			arrivalsHorizon[h][p]= 0; 
+			arrivalsHorizon[horizonBuffer][h][p]= 0; 
 		}
 	}	
 }
@@ -435,10 +480,11 @@ void updateHorizon( float simulationTime)
 			if (horizonTime < HORIZON_SIZE) //70-s (0-69)
 			{
 				ARRIVALDATA detected = detectedArrivals[i];
-				arrivalsHorizon[horizonTime][detected.phase]+=1;
+				arrivalsHorizon[horizonBuffer][horizonTime][detected.phase]+=1;
 			}
 		}
 	}
+	latestBuffer = horizonBuffer;
 }
 
 /* ---------------------------------------------------------------------
@@ -463,7 +509,7 @@ void printVectorToFile()
 		for(int h=0; h<70; h++){
 			for(int p=0; p<3; p++)
 			{
-				myfile << arrivalsHorizon[h][p] << " ";
+				myfile << arrivalsHorizon[latestBuffer][h][p] << " ";
 			}
 			myfile << "\n";
 		}
@@ -576,13 +622,21 @@ void qpx_NET_timeStep()
 		if (isAllRed)
 			hThread = new HANDLE();
 		else
+		{
+			solverBuffer = horizonBuffer;	/* hand the horizon over, the next one is built in the other buffer */
+			horizonBuffer = 1 - horizonBuffer;
+			float switchTime = lastControlTime + currentControl + ALL_RED;	/* the thread gets these, nextPhase moves on under it */
+			solverPhase = nextPhase;
+			solverDelay = switchTime > currentTime ? (unsigned int)((switchTime - currentTime) / qpg_CFG_timeStep() + 0.5f) : 0;
 			hThread = (HANDLE)_beginthreadex( NULL, 0, &COPThreadFunc, NULL, 0, &threadID);		/* init new thread */
+		}
 			
 	}
 
 	float timeToRed = lastControlTime + currentControl; /*	switch points */
 	float timeToNext = timeToRed + ALL_RED;
 
+	sequenceLock.lock();
 	if (isSequenceReady)
 	{
 		if (!isAllRed)									/* discard sequences till next phase*/	
@@ -629,6 +683,7 @@ void qpx_NET_timeStep()
 			lastControlTime = currentTime;
 		}
 	}
+	sequenceLock.unlock();
 }
 
 /* ---------------------------------------------------------------------